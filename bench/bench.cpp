@@ -0,0 +1,745 @@
+
+#include <xstream.h>
+#include <xstream_dom.h>
+#include <xstream_parallel.h>
+#include <xstream_index.h>
+#include "baseline.h"
+#include "corpus.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+double now()
+{
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+std::string text_heavy_document(size_t size)
+{
+	std::string xml = "<root>\n";
+	std::string para;
+	for (int i = 0; i < 40; i++) {
+		para += "The quick brown fox jumps over the lazy dog. ";
+	}
+	while (xml.size() < size) {
+		xml += "<p>" + para + "</p>\n";
+	}
+	xml += "</root>\n";
+	return xml;
+}
+
+void report(char const *name, size_t bytes, double sec)
+{
+	printf("%-24s %10.1f MB/s\n", name, bytes / sec / 1e6);
+}
+
+size_t run_reader(std::string const &xml)
+{
+	size_t n = 0;
+	xstream::Reader r(xml);
+	while (r.next()) {
+		n++;
+	}
+	return n;
+}
+
+// the first release of the reader, which scanned text a byte at a time
+size_t run_baseline_reader(std::string const &xml)
+{
+	size_t n = 0;
+	xstream_baseline::Reader r(xml);
+	while (r.next()) {
+		n++;
+	}
+	return n;
+}
+
+size_t run_find_escape(std::string const &xml)
+{
+	size_t n = 0;
+	char const *end = xml.data() + xml.size();
+	for (char const *p = xml.data(); (p = xstream::simd::find_escape(p, end, true)) < end; p++) {
+		n++;
+	}
+	return n;
+}
+
+size_t run_find_tag_end(std::string const &xml)
+{
+	size_t n = 0;
+	char const *end = xml.data() + xml.size();
+	for (char const *p = xml.data(); (p = xstream::simd::find_tag_end(p, end)) < end; p++) {
+		n++;
+	}
+	return n;
+}
+
+template <typename F> double measure(F fn, int rounds)
+{
+	double best = 1e9;
+	for (int i = 0; i < rounds; i++) {
+		double t = now();
+		volatile size_t n = fn();
+		(void)n;
+		best = std::min(best, now() - t);
+	}
+	return best;
+}
+
+void bench_scan()
+{
+	std::string xml = text_heavy_document(64 << 20);
+	printf("text-heavy document, %zu bytes\n", xml.size());
+
+	report("Reader (baseline)", xml.size(), measure([&](){ return run_baseline_reader(xml); }, 5));
+	report("Reader", xml.size(), measure([&](){ return run_reader(xml); }, 5));
+
+	// single bytes are found with memchr at every level; these two scans dispatch by level
+	std::string atts = corpus::generate(corpus::Attributes, 64 << 20);
+	static char const *levels[] = { "scalar", "sse2", "avx2" };
+	xstream::simd::Level saved = xstream::simd::level();
+	for (int level = xstream::simd::Scalar; level <= xstream::simd::AVX2; level++) {
+		xstream::simd::set_level((xstream::simd::Level)level);
+		if (xstream::simd::level() != level) continue;
+		std::string name = std::string("find_escape (") + levels[level] + ")";
+		report(name.c_str(), xml.size(), measure([&](){ return run_find_escape(xml); }, 5));
+		name = std::string("find_tag_end (") + levels[level] + ")";
+		report(name.c_str(), atts.size(), measure([&](){ return run_find_tag_end(atts); }, 5));
+	}
+	xstream::simd::set_level(saved);
+}
+
+void bench_reuse()
+{
+	std::vector<std::string> messages;
+	for (int i = 0; i < 1000; i++) {
+		messages.push_back("<message id=\"" + std::to_string(i) + "\" type=\"update\"><header><from>svc-a</from><to>svc-b</to></header><body><value>" + std::to_string(i * 7) + "</value></body></message>");
+	}
+	int const rounds = 1000;
+	size_t count = messages.size() * rounds;
+	printf("%zu small messages\n", count);
+
+	double fresh = measure([&](){
+		size_t n = 0;
+		for (int i = 0; i < rounds; i++) {
+			for (auto const &m : messages) {
+				xstream::Reader r(m);
+				while (r.next()) {
+					n++;
+				}
+			}
+		}
+		return n;
+	}, 3);
+	printf("%-24s %10.1f ns/message\n", "new Reader", fresh / count * 1e9);
+
+	double reused = measure([&](){
+		size_t n = 0;
+		xstream::Reader r;
+		for (int i = 0; i < rounds; i++) {
+			for (auto const &m : messages) {
+				r.reset(m);
+				while (r.next()) {
+					n++;
+				}
+			}
+		}
+		return n;
+	}, 3);
+	printf("%-24s %10.1f ns/message\n", "Reader::reset()", reused / count * 1e9);
+}
+
+void bench_lazy()
+{
+	std::string xml = "<root>";
+	for (int i = 0; xml.size() < (32 << 20); i++) {
+		xml += "<row id=\"" + std::to_string(i) + "\" a=\"alpha\" b=\"bravo\" c=\"charlie\" d=\"delta\" e=\"echo\" f=\"foxtrot\" g=\"golf\"/>";
+		if (i % 100 == 0) {
+			xml += "<wanted key=\"" + std::to_string(i) + "\"/>";
+		}
+	}
+	xml += "</root>";
+	printf("attribute-heavy document, %zu bytes, reading 1%% of the elements\n", xml.size());
+
+	for (bool lazy : {false, true}) {
+		double sec = measure([&](){
+			size_t n = 0;
+			xstream::Reader r(xml);
+			r.set_lazy_attributes(lazy);
+			while (r.next()) {
+				if (r.is_start_element() && r.is_name("wanted")) {
+					n += r.attribute("key").has_value();
+				}
+			}
+			return n;
+		}, 5);
+		report(lazy ? "lazy attributes" : "eager attributes", xml.size(), sec);
+	}
+}
+
+void bench_encode()
+{
+	std::string text;
+	for (int i = 0; i < 40; i++) {
+		text += "Tom & Jerry <cartoon> \"quoted\" text with a few escapes. ";
+	}
+	int const count = 20000;
+	printf("writer, %d elements of %zu bytes of text\n", count, text.size());
+
+	auto write = [&](auto &w){
+		w.start_document();
+		w.start_element("root");
+		for (int i = 0; i < count; i++) {
+			w.start_element("p");
+			w.write_attribute("title", "a \"title\" & more");
+			w.write_characters(text);
+			w.end_element();
+		}
+		w.end_document();
+	};
+
+	size_t bytes = 0;
+	double sec = measure([&](){
+		std::string out;
+		xstream::Writer w([&](char const *p, int n){
+			out.append(p, n);
+			return n;
+		});
+		write(w);
+		bytes = out.size();
+		return out.size();
+	}, 5);
+	report("Writer", bytes, sec);
+
+	sec = measure([&](){
+		std::string out;
+		xstream::BasicWriter<xstream::StringSink> w(&out);
+		write(w);
+		return out.size();
+	}, 5);
+	report("BasicWriter<StringSink>", bytes, sec);
+
+	std::string doc = text_heavy_document(16 << 20);
+	report("html_encode", doc.size(), measure([&](){ return xstream::html_encode(doc).size(); }, 5));
+}
+
+void bench_tags()
+{
+	int const count = 1000000;
+	printf("writer, %d records of small elements\n", count);
+
+	size_t bytes = 0;
+	double sec = measure([&](){
+		std::string out;
+		xstream::BasicWriter<xstream::StringSink> w(&out);
+		w.set_compact(true);
+		w.start_element("export");
+		for (int i = 0; i < count; i++) {
+			w.start_element("record");
+			w.text_element("customer_name", "name");
+			w.text_element("billing_address", "address");
+			w.end_element();
+		}
+		w.end_document();
+		bytes = out.size();
+		return out.size();
+	}, 3);
+	report("element names", bytes, sec);
+
+	sec = measure([&](){
+		std::string out;
+		xstream::BasicWriter<xstream::StringSink> w(&out);
+		w.set_compact(true);
+		auto record = w.tag("record");
+		auto name = w.tag("customer_name");
+		auto address = w.tag("billing_address");
+		w.start_element("export");
+		for (int i = 0; i < count; i++) {
+			w.start_element(record);
+			w.text_element(name, "name");
+			w.text_element(address, "address");
+			w.end_element();
+		}
+		w.end_document();
+		return out.size();
+	}, 3);
+	report("tag handles", bytes, sec);
+}
+
+void bench_skip()
+{
+	std::string body;
+	for (int i = 0; i < 20; i++) {
+		body += "<line no=\"" + std::to_string(i) + "\"><sku>A-100</sku><qty>3</qty><note>fragile &amp; heavy</note></line>";
+	}
+	std::string xml = "<orders>";
+	for (int i = 0; xml.size() < (32 << 20); i++) {
+		xml += "<order id=\"" + std::to_string(i) + "\"><lines>" + body + "</lines></order>";
+	}
+	xml += "</orders>";
+	printf("%zu bytes, reading order ids only\n", xml.size());
+
+	for (bool skip : {false, true}) {
+		double sec = measure([&](){
+			size_t n = 0;
+			xstream::Reader r(xml);
+			while (r.next()) {
+				if (r.is_start_element("order")) {
+					n += r.attribute("id").has_value();
+				} else if (skip && r.is_start_element("lines")) {
+					r.skip_element();
+				}
+			}
+			return n;
+		}, 5);
+		report(skip ? "skip_element()" : "next()", xml.size(), sec);
+	}
+}
+
+void bench_dom()
+{
+	std::string xml = "<config>";
+	for (int i = 0; i < 200; i++) {
+		xml += "<section name=\"s" + std::to_string(i) + "\"><key>value " + std::to_string(i) + "</key><flag on=\"true\"/></section>";
+	}
+	xml += "</config>";
+	int const queries = 20000;
+	printf("%d lookups in a %zu byte document\n", queries, xml.size());
+
+	double sec = measure([&](){
+		size_t n = 0;
+		for (int q = 0; q < queries; q++) {
+			std::string want = "s" + std::to_string(q % 200);
+			xstream::Reader r(xml);
+			bool hit = false;
+			while (r.next()) {
+				if (r.is_start_element("section")) {
+					hit = r.attribute("name", {}) == want;
+				} else if (hit && r.is_end_element("key")) {
+					n += r.text().size();
+					break;
+				}
+			}
+		}
+		return n;
+	}, 3);
+	printf("%-24s %10.1f us/lookup\n", "Reader, reparsing", sec / queries * 1e6);
+
+	sec = measure([&](){
+		size_t n = 0;
+		auto doc = xstream::Document::parse(xml);
+		uint32_t root = doc->document_element();
+		for (int q = 0; q < queries; q++) {
+			std::string want = "s" + std::to_string(q % 200);
+			for (uint32_t i = doc->first_element(root); i != xstream::Document::npos; i = doc->next_element(i)) {
+				auto name = doc->attribute(i, "name");
+				if (name && name->raw() == want) {
+					n += doc->text(doc->child(i, "key")).size();
+					break;
+				}
+			}
+		}
+		return n;
+	}, 3);
+	printf("%-24s %10.1f us/lookup\n", "Document", sec / queries * 1e6);
+}
+
+void bench_parallel()
+{
+	std::string xml = "<records>\n";
+	for (int i = 0; xml.size() < (128 << 20); i++) {
+		xml += "<record id=\"" + std::to_string(i) + "\"><name>item " + std::to_string(i) + "</name><price currency=\"EUR\">12.50</price><tags><tag>a</tag><tag>b</tag></tags><!-- note --></record>\n";
+	}
+	xml += "</records>\n";
+	unsigned cores = std::thread::hardware_concurrency();
+	printf("%zu bytes of records, %u hardware threads\n", xml.size(), cores);
+
+	double base = 0;
+	for (unsigned threads = 1; threads <= std::max(cores, 1u); threads *= 2) {
+		xstream::ParallelOptions options;
+		options.threads = threads;
+		double sec = measure([&](){
+			std::vector<size_t> sums(threads);
+			xstream::parse_parallel(xml, [&](xstream::Reader &r, unsigned thread){
+				while (r.next()) {
+					if (r.is_end_element("price")) {
+						sums[thread] += r.text().size();
+					} else if (r.is_end_element("record")) {
+						break;
+					}
+				}
+			}, options);
+			size_t n = 0;
+			for (size_t s : sums) {
+				n += s;
+			}
+			return n;
+		}, 3);
+		if (threads == 1) {
+			base = sec;
+		}
+		char name[32];
+		sprintf(name, "%u threads", threads);
+		printf("%-24s %10.1f MB/s  x%.2f\n", name, xml.size() / sec / 1e6, base / sec);
+	}
+}
+
+void bench_index()
+{
+	std::string xml = "<customers>\n";
+	for (int i = 0; xml.size() < (32 << 20); i++) {
+		xml += "<customer id=\"c" + std::to_string(i) + "\"><name>customer " + std::to_string(i) + "</name><address>street " + std::to_string(i % 97) + "</address><balance>" + std::to_string(i * 3) + "</balance></customer>\n";
+	}
+	xml += "</customers>\n";
+	int const queries = 100;
+	printf("%d lookups by key in a %zu byte document\n", queries, xml.size());
+
+	xstream::PathSet paths;
+	paths.add("/customers/customer");
+	double t = now();
+	xstream::Index index = xstream::Index::build(xml, paths, "id");
+	printf("%-24s %10.1f ms, %zu entries\n", "Index::build", (now() - t) * 1e3, index.size());
+
+	auto lookup = [&](auto open){
+		size_t n = 0;
+		for (int q = 0; q < queries; q++) {
+			std::string want = "c" + std::to_string((size_t)q * 7919 % index.size());
+			n += open(want);
+		}
+		return n;
+	};
+
+	double sec = measure([&](){
+		return lookup([&](std::string const &want){
+			xstream::Reader r(xml);
+			while (r.next()) {
+				if (r.is_start_element("customer") && r.attribute("id", {}) == want) {
+					return (size_t)1;
+				}
+			}
+			return (size_t)0;
+		});
+	}, 1);
+	printf("%-24s %10.1f us/lookup\n", "Reader, scanning", sec / queries * 1e6);
+
+	sec = measure([&](){
+		return lookup([&](std::string const &want){
+			size_t n = 0;
+			auto r = index.reader(xml, index.find(want));
+			while (r && r->next()) {
+				n += r->is_end_element("balance");
+			}
+			return n;
+		});
+	}, 3);
+	printf("%-24s %10.1f us/lookup\n", "Index::reader", sec / queries * 1e6);
+}
+
+// a reader event, decoded, for replaying through the writer
+struct Event {
+	xstream::Reader::StateType type;
+	std::string name;
+	std::vector<std::pair<std::string, std::string>> atts;
+	std::string text;
+};
+
+std::vector<Event> record_events(std::string const &xml)
+{
+	std::vector<Event> events;
+	xstream::Reader r(xml);
+	while (r.next()) {
+		Event e;
+		e.type = r.state();
+		if (r.is_start_element()) {
+			e.name = r.name();
+			r.for_each_attribute([&](std::string_view name, xstream::Reader::EscapedAttributeValue const &value){
+				e.atts.emplace_back(std::string(name), value.to_string());
+			});
+		} else if (r.is_characters()) {
+			std::vector<char> v = r.characters().decode();
+			e.text.assign(v.data(), v.size());
+		} else if (!r.is_end_element()) {
+			continue;
+		}
+		events.push_back(std::move(e));
+	}
+	return events;
+}
+
+// the raw character data and attribute values of a document, as html_decode input
+std::string escaped_text(std::string const &xml)
+{
+	std::string text;
+	xstream::Reader r(xml);
+	while (r.next()) {
+		if (r.is_start_element()) {
+			r.for_each_attribute([&](std::string_view, xstream::Reader::EscapedAttributeValue const &value){
+				text += value.raw();
+			});
+		} else if (r.is_characters()) {
+			auto part = r.characters();
+			if (part.type() == decltype(part)::Text) {
+				text += part.raw();
+			}
+		}
+	}
+	return text;
+}
+
+void bench_corpus()
+{
+	size_t const size = 16 << 20;
+	printf("synthetic corpora of %zu bytes, MB/s unless noted\n", size);
+	printf("%-12s %9s %9s %9s %11s %9s %9s %9s\n", "corpus", "next()", "Mevents/s", "text()", "attribute()", "decode", "encode", "Writer");
+
+	for (int shape = 0; shape < corpus::ShapeCount; shape++) {
+		std::string xml = corpus::generate((corpus::Shape)shape, size);
+		auto mbps = [](size_t bytes, double sec){ return bytes / sec / 1e6; };
+
+		size_t events = 0;
+		double next = measure([&](){
+			events = run_reader(xml);
+			return events;
+		}, 3);
+
+		double text = measure([&](){
+			size_t n = 0;
+			xstream::Reader r(xml);
+			while (r.next()) {
+				if (r.is_end_element()) {
+					n += r.text().size();
+				}
+			}
+			return n;
+		}, 3);
+
+		double attribute = measure([&](){
+			size_t n = 0;
+			xstream::Reader r(xml);
+			while (r.next()) {
+				if (r.is_start_element()) {
+					if (auto id = r.attribute("id")) {
+						n += id->to_string().size();
+					}
+				}
+			}
+			return n;
+		}, 3);
+
+		std::string escaped = escaped_text(xml);
+		std::string decoded = xstream::html_decode(escaped);
+		double decode = measure([&](){ return xstream::html_decode(escaped).size(); }, 3);
+		double encode = measure([&](){ return xstream::html_encode(decoded).size(); }, 3);
+
+		std::vector<Event> recorded = record_events(xml);
+		size_t written = 0;
+		double writer = measure([&](){
+			std::string out;
+			out.reserve(xml.size());
+			xstream::BasicWriter<xstream::StringSink> w(&out);
+			w.set_compact(true);
+			w.start_document();
+			for (Event const &e : recorded) {
+				if (e.type == xstream::Reader::StartElement) {
+					w.start_element(e.name);
+					for (auto const &a : e.atts) {
+						w.write_attribute(a.first, a.second);
+					}
+				} else if (e.type == xstream::Reader::EndElement) {
+					w.end_element();
+				} else {
+					w.write_characters(e.text);
+				}
+			}
+			w.end_document();
+			written = out.size();
+			return out.size();
+		}, 3);
+
+		printf("%-12s %9.1f %9.1f %9.1f %11.1f %9.1f %9.1f %9.1f\n", corpus::shape_name((corpus::Shape)shape),
+			   mbps(xml.size(), next), events / next / 1e6, mbps(xml.size(), text), mbps(xml.size(), attribute),
+			   mbps(escaped.size(), decode), mbps(decoded.size(), encode), mbps(written, writer));
+	}
+}
+
+void bench_text()
+{
+	size_t const size = 16 << 20;
+	printf("synthetic corpora of %zu bytes, text of every element\n", size);
+	for (corpus::Shape shape : {corpus::Wide, corpus::Text, corpus::Entities, corpus::Pretty}) {
+		std::string xml = corpus::generate(shape, size);
+		auto run = [&](auto use){
+			return measure([&](){
+				size_t n = 0;
+				xstream::Reader r(xml);
+				while (r.next()) {
+					if (r.is_end_element()) {
+						n += use(r);
+					}
+				}
+				return n;
+			}, 3);
+		};
+		double text = run([](xstream::Reader &r){ return r.text().size(); });
+		std::string buffer;
+		double into = run([&](xstream::Reader &r){
+			r.text_into(buffer);
+			return buffer.size();
+		});
+		double view = run([&](xstream::Reader &r){
+			if (auto v = r.text_view()) return v->size();
+			r.text_into(buffer);
+			return buffer.size();
+		});
+		double chunks = run([](xstream::Reader &r){
+			size_t n = 0;
+			r.for_each_text_chunk([&](std::string_view s){ n += s.size(); });
+			return n;
+		});
+		auto mbps = [&](double sec){ return xml.size() / sec / 1e6; };
+		printf("%-12s text() %8.1f  text_into() %8.1f  text_view() %8.1f  chunks %8.1f MB/s\n", corpus::shape_name(shape), mbps(text), mbps(into), mbps(view), mbps(chunks));
+	}
+}
+
+void bench_base64()
+{
+	std::string blob;
+	for (size_t i = 0; i < (48 << 20); i++) {
+		blob += (char)(i * 2654435761u >> 13);
+	}
+	std::string b64(xstream::base64_encoded_size(blob.size()), 0);
+	std::string xml;
+	{
+		xstream::BasicWriter<xstream::StringSink> w(&xml);
+		w.start_element("payload");
+		w.write_base64(blob.data(), blob.size());
+		w.end_element();
+	}
+	printf("%zu bytes of base64 in one element\n", xml.size());
+
+	static char const *names[] = { "scalar", "sse2", "avx2" };
+	xstream::simd::Level saved = xstream::simd::level();
+	for (int level = xstream::simd::Scalar; level <= xstream::simd::AVX2; level += 2) {
+		xstream::simd::set_level((xstream::simd::Level)level);
+		if (xstream::simd::level() != level) continue;
+		char name[32];
+		double sec = measure([&](){ return size_t(xstream::base64_encode_to(blob.data(), blob.size(), &b64[0]) - b64.data()); }, 3);
+		sprintf(name, "encode (%s)", names[level]);
+		report(name, b64.size(), sec);
+		std::string out(blob.size() + 3, 0);
+		sec = measure([&](){
+			xstream::Base64Decoder d;
+			return size_t(d.finish(d.decode(b64, &out[0])) - out.data());
+		}, 3);
+		sprintf(name, "decode (%s)", names[level]);
+		report(name, b64.size(), sec);
+	}
+	xstream::simd::set_level(saved);
+
+	double sec = measure([&](){
+		std::string out;
+		xstream::Reader r(xml);
+		while (r.next()) {
+			if (r.is_end_element("payload")) {
+				std::string text = r.text();
+				out.resize(text.size());
+				xstream::Base64Decoder d;
+				out.resize(d.finish(d.decode(text, &out[0])) - out.data());
+			}
+		}
+		return out.size();
+	}, 3);
+	report("text() then decode", xml.size(), sec);
+	sec = measure([&](){
+		std::string out;
+		xstream::Reader r(xml);
+		while (r.next()) {
+			if (r.is_end_element("payload")) {
+				r.read_base64(out);
+			}
+		}
+		return out.size();
+	}, 3);
+	report("read_base64()", xml.size(), sec);
+	sec = measure([&](){
+		std::string out;
+		xstream::BasicWriter<xstream::StringSink> w(&out);
+		w.start_element("payload");
+		w.write_base64(blob.data(), blob.size());
+		w.end_element();
+		w.flush();
+		return out.size();
+	}, 3);
+	report("write_base64()", xml.size(), sec);
+}
+
+// only events and element names
+struct EventsOnly : xstream::ReaderPolicy {
+	static constexpr bool paths = false;
+	static constexpr bool text = false;
+	static constexpr bool comments = false;
+	static constexpr bool attributes = false;
+	static constexpr bool nesting = false;
+};
+
+void bench_policy()
+{
+	size_t const size = 16 << 20;
+	printf("synthetic corpora of %zu bytes, next() only\n", size);
+	for (corpus::Shape shape : {corpus::Wide, corpus::Deep, corpus::Attributes, corpus::Pretty}) {
+		std::string xml = corpus::generate(shape, size);
+		double full = measure([&](){ return run_reader(xml); }, 3);
+		double lean = measure([&](){
+			size_t n = 0;
+			xstream::BasicReader<EventsOnly> r(xml);
+			while (r.next()) {
+				n++;
+			}
+			return n;
+		}, 3);
+		printf("%-12s %-12s %8.1f MB/s  %-12s %8.1f MB/s\n", corpus::shape_name(shape), "Reader", xml.size() / full / 1e6, "EventsOnly", xml.size() / lean / 1e6);
+	}
+}
+
+struct Benchmark {
+	char const *name;
+	void (*fn)();
+};
+
+Benchmark const benchmarks[] = {
+	{ "scan", bench_scan },
+	{ "reuse", bench_reuse },
+	{ "lazy", bench_lazy },
+	{ "encode", bench_encode },
+	{ "tags", bench_tags },
+	{ "skip", bench_skip },
+	{ "dom", bench_dom },
+	{ "parallel", bench_parallel },
+	{ "index", bench_index },
+	{ "corpus", bench_corpus },
+	{ "policy", bench_policy },
+	{ "text", bench_text },
+	{ "base64", bench_base64 },
+};
+
+} // namespace
+
+// bench [name...]: runs the named benchmarks, or all of them
+int main(int argc, char **argv)
+{
+	for (Benchmark const &b : benchmarks) {
+		bool run = argc < 2;
+		for (int i = 1; i < argc; i++) {
+			run |= strcmp(argv[i], b.name) == 0;
+		}
+		if (run) {
+			b.fn();
+		}
+	}
+	return 0;
+}
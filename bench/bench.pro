@@ -0,0 +1,16 @@
+TEMPLATE = app
+TARGET = bench
+CONFIG -= qt
+CONFIG += console release
+
+INCLUDEPATH += ../include
+
+HEADERS += \
+	../include/xstream.h \
+	../include/xstream_dom.h \
+	../include/xstream_parallel.h \
+	../include/xstream_index.h \
+	baseline.h \
+	corpus.h
+SOURCES += \
+	bench.cpp
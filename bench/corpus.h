@@ -0,0 +1,168 @@
+#ifndef BENCH_CORPUS_H
+#define BENCH_CORPUS_H
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Deterministic synthetic XML documents for the benchmarks.
+ *
+ * Every shape is generated from a fixed seed with a hand-rolled generator, so
+ * a given (shape, size) yields the same bytes on every platform and release.
+ */
+namespace corpus {
+
+enum Shape {
+	Wide,       // one flat level of many small elements
+	Deep,       // subtrees nested 32 levels deep
+	Attributes, // elements with ten attributes each
+	Text,       // long paragraphs of character data
+	Entities,   // text dense with named and numeric references
+	CDATA,      // code blocks in CDATA sections
+	Pretty,     // indented records, as written by a pretty printer
+	ShapeCount,
+};
+
+static inline char const *shape_name(Shape shape)
+{
+	static char const *names[] = { "wide", "deep", "attributes", "text", "entities", "cdata", "pretty" };
+	return names[shape];
+}
+
+class Random {
+private:
+	uint64_t state_;
+public:
+	explicit Random(uint64_t seed)
+		: state_(seed)
+	{
+	}
+	uint32_t next()
+	{
+		state_ = state_ * 6364136223846793005ull + 1442695040888963407ull;
+		return uint32_t(state_ >> 33);
+	}
+	size_t below(size_t n)
+	{
+		return next() % n;
+	}
+};
+
+static inline char const *word_(Random &rnd)
+{
+	static char const *words[] = {
+		"alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel",
+		"india", "juliett", "kilo", "lima", "mike", "november", "oscar", "papa",
+	};
+	return words[rnd.below(16)];
+}
+
+static inline void words_(std::string *out, Random &rnd, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		if (i > 0) *out += ' ';
+		*out += word_(rnd);
+	}
+}
+
+static inline void entity_text_(std::string *out, Random &rnd, size_t count)
+{
+	static char const *refs[] = { "&amp;", "&lt;", "&gt;", "&quot;", "&apos;", "&#169;", "&#x20AC;", "&#12354;" };
+	for (size_t i = 0; i < count; i++) {
+		if (i > 0) *out += ' ';
+		*out += word_(rnd);
+		*out += refs[rnd.below(8)];
+	}
+}
+
+static inline void record_(std::string *out, Random &rnd, Shape shape, size_t n)
+{
+	std::string id = std::to_string(n);
+	switch (shape) {
+	case Wide:
+		*out += "<item id=\"" + id + "\">";
+		*out += word_(rnd);
+		*out += "</item>";
+		break;
+	case Deep:
+		for (int i = 0; i < 32; i++) {
+			*out += "<n" + std::to_string(i) + " id=\"" + id + "\">";
+		}
+		words_(out, rnd, 4);
+		for (int i = 31; i >= 0; i--) {
+			*out += "</n" + std::to_string(i) + ">";
+		}
+		break;
+	case Attributes:
+		*out += "<row";
+		for (int i = 0; i < 9; i++) {
+			*out += " a" + std::to_string(i) + "=\"";
+			*out += word_(rnd);
+			*out += rnd.below(4) == 0 ? " &amp; " : " ";
+			*out += std::to_string(rnd.below(100000)) + "\"";
+		}
+		*out += " id=\"" + id + "\"/>";
+		break;
+	case Text:
+		*out += "<p id=\"" + id + "\">";
+		words_(out, rnd, 50 + rnd.below(300));
+		*out += "</p>";
+		break;
+	case Entities:
+		*out += "<p id=\"" + id + "\">";
+		entity_text_(out, rnd, 20 + rnd.below(100));
+		*out += "</p>";
+		break;
+	case CDATA:
+		*out += "<code id=\"" + id + "\"><![CDATA[";
+		for (size_t i = 0, lines = 5 + rnd.below(20); i < lines; i++) {
+			*out += "if (a < b && ";
+			*out += word_(rnd);
+			*out += "[i] > 0) { x = \"<tag>\"; }\n";
+		}
+		*out += "]]></code>";
+		break;
+	case Pretty:
+		*out += "  <record id=\"" + id + "\">\n";
+		*out += "    <name>";
+		words_(out, rnd, 2);
+		*out += "</name>\n";
+		*out += "    <address type=\"home\">\n";
+		*out += "      <street>" + std::to_string(rnd.below(1000)) + " ";
+		*out += word_(rnd);
+		*out += " street</street>\n";
+		*out += "      <city>";
+		*out += word_(rnd);
+		*out += "</city>\n";
+		*out += "    </address>\n";
+		*out += "    <note>";
+		words_(out, rnd, 10 + rnd.below(20));
+		*out += "</note>\n";
+		*out += "  </record>\n";
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * @brief Generates a document of the given shape of at least size bytes.
+ */
+static inline std::string generate(Shape shape, size_t size, uint64_t seed = 1)
+{
+	Random rnd(seed * 0x9e3779b97f4a7c15ull + shape);
+	std::string xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<root>\n";
+	xml.reserve(size + 4096);
+	for (size_t n = 0; xml.size() < size; n++) {
+		record_(&xml, rnd, shape, n);
+		if (shape != Pretty && n % 16 == 15) {
+			xml += '\n';
+		}
+	}
+	xml += "</root>\n";
+	return xml;
+}
+
+} // namespace corpus
+
+#endif // BENCH_CORPUS_H
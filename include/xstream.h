@@ -5,164 +5,1180 @@
 #ifndef XSTREAM_H
 #define XSTREAM_H
 
+#include <algorithm>
 #include <assert.h>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
 #include <cstdio>
 #include <cstring>
 #include <functional>
+#include <map>
+#include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 // #include "htmlencode.h"
 
+#if !defined(XSTREAM_NO_SIMD) && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64))
+#define XSTREAM_SIMD_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define XSTREAM_TARGET_AVX2
+#else
+#define XSTREAM_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+#ifndef XSTREAM_NO_MMAP
+#ifdef _WIN32
+// without these, windows.h defines min and max macros that break std::min and std::max below
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#endif
+
 namespace xstream {
 
-#ifdef __HTMLENCODE_H
+// fast delimiter scanning
 
-inline std::string html_encode(std::string_view const &str)
+namespace simd {
+
+enum Level {
+	Scalar,
+	SSE2,
+	AVX2,
+};
+
+static inline int ctz32(unsigned int v)
 {
-	return ::html_encode(str, true);
+#ifdef _MSC_VER
+	unsigned long i;
+	_BitScanForward(&i, v);
+	return (int)i;
+#else
+	return __builtin_ctz(v);
+#endif
+}
 
+static inline Level detect()
+{
+#ifdef XSTREAM_SIMD_X86
+#ifdef _MSC_VER
+	int r[4];
+	__cpuid(r, 0);
+	if (r[0] >= 7) {
+		__cpuid(r, 1);
+		bool osxsave = (r[2] & (1 << 27)) != 0;
+		bool avx = (r[2] & (1 << 28)) != 0;
+		if (osxsave && avx && (_xgetbv(0) & 6) == 6) {
+			__cpuidex(r, 7, 0);
+			if (r[1] & (1 << 5)) return AVX2;
+		}
+	}
+	return SSE2;
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) return AVX2;
+	if (__builtin_cpu_supports("sse2")) return SSE2;
+#endif
+#endif
+	return Scalar;
 }
 
-inline std::string html_decode(std::string_view const &str)
+static inline Level &level_()
 {
-	return ::html_decode(str);
+	static Level level = detect();
+	return level;
 }
 
-#else
+static inline Level level()
+{
+	return level_();
+}
 
-static inline void vecprint(std::vector<char> *out, char c)
+// for tests and benchmarks; a level the cpu does not support is clamped
+static inline void set_level(Level level)
 {
-	out->push_back(c);
+	Level supported = detect();
+	level_() = level < supported ? level : supported;
 }
 
-static inline void vecprint(std::vector<char> *out, char const *s)
+// returns the first occurrence of c in [p, end), or end
+// (memchr is already vectorized by the C library; hand-written SIMD only pays off for byte classes)
+static inline char const *find(char const *p, char const *end, char c)
 {
-	out->insert(out->end(), s, s + strlen(s));
+	if (p >= end) return end;
+	void const *q = memchr(p, (unsigned char)c, end - p);
+	return q ? (char const *)q : end;
 }
 
-static inline void html_encode_(char const *ptr, char const *end, bool utf8through, std::vector<char> *vec)
+// whether html_encode writes c as a reference
+static inline bool needs_escape(unsigned char c, bool utf8through)
 {
-	while (ptr < end) {
-		int c = *ptr & 0xff;
-		ptr++;
-		switch (c) {
-		case '&':
-			vecprint(vec, "&amp;");
-			break;
-		case '<':
-			vecprint(vec, "&lt;");
-			break;
-		case '>':
-			vecprint(vec, "&gt;");
-			break;
-		case '\"':
-			vecprint(vec, "&quot;");
-			break;
-		case '\'':
-			vecprint(vec, "&apos;");
-			break;
-		case '\t':
-		case '\n':
-			vecprint(vec, c);
-			break;
-		default:
-			if (c < 0x80 ? (c < 0x20 || c == '\'') : !utf8through) {
-				char tmp[10];
-				sprintf(tmp, "&#%u;", c);
-				vecprint(vec, tmp);
-			} else {
-				vecprint(vec, c);
+	if (c >= 0x80) return !utf8through;
+	if (c < 0x20) return c != '\t' && c != '\n';
+	return c == '&' || c == '<' || c == '>' || c == '\"' || c == '\'';
+}
+
+static inline char const *find_escape_scalar(char const *p, char const *end, bool utf8through)
+{
+	while (p < end && !needs_escape((unsigned char)*p, utf8through)) {
+		p++;
+	}
+	return p;
+}
+
+#ifdef XSTREAM_SIMD_X86
+static inline char const *find_escape_sse2(char const *p, char const *end, bool utf8through)
+{
+	// '&' and '\'' differ only in bit 0, '<' and '>' only in bit 1
+	__m128i const one = _mm_set1_epi8(1);
+	__m128i const two = _mm_set1_epi8(2);
+	__m128i const amp = _mm_set1_epi8('\'');
+	__m128i const gt = _mm_set1_epi8('>');
+	__m128i const quot = _mm_set1_epi8('\"');
+	__m128i const ctl = _mm_set1_epi8(0x1f);
+	__m128i const tab = _mm_set1_epi8('\t');
+	__m128i const lf = _mm_set1_epi8('\n');
+	while (end - p >= 16) {
+		__m128i x = _mm_loadu_si128((__m128i const *)p);
+		__m128i m = _mm_or_si128(_mm_cmpeq_epi8(_mm_or_si128(x, one), amp), _mm_cmpeq_epi8(_mm_or_si128(x, two), gt));
+		m = _mm_or_si128(m, _mm_cmpeq_epi8(x, quot));
+		__m128i c = _mm_cmpeq_epi8(_mm_min_epu8(x, ctl), x);
+		c = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi8(x, tab), _mm_cmpeq_epi8(x, lf)), c);
+		int bits = _mm_movemask_epi8(_mm_or_si128(m, c));
+		if (!utf8through) {
+			bits |= _mm_movemask_epi8(x);
+		}
+		if (bits) return p + ctz32(bits);
+		p += 16;
+	}
+	return find_escape_scalar(p, end, utf8through);
+}
+
+XSTREAM_TARGET_AVX2 static inline char const *find_escape_avx2(char const *p, char const *end, bool utf8through)
+{
+	__m256i const one = _mm256_set1_epi8(1);
+	__m256i const two = _mm256_set1_epi8(2);
+	__m256i const amp = _mm256_set1_epi8('\'');
+	__m256i const gt = _mm256_set1_epi8('>');
+	__m256i const quot = _mm256_set1_epi8('\"');
+	__m256i const ctl = _mm256_set1_epi8(0x1f);
+	__m256i const tab = _mm256_set1_epi8('\t');
+	__m256i const lf = _mm256_set1_epi8('\n');
+	while (end - p >= 32) {
+		__m256i x = _mm256_loadu_si256((__m256i const *)p);
+		__m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_or_si256(x, one), amp), _mm256_cmpeq_epi8(_mm256_or_si256(x, two), gt));
+		m = _mm256_or_si256(m, _mm256_cmpeq_epi8(x, quot));
+		__m256i c = _mm256_cmpeq_epi8(_mm256_min_epu8(x, ctl), x);
+		c = _mm256_andnot_si256(_mm256_or_si256(_mm256_cmpeq_epi8(x, tab), _mm256_cmpeq_epi8(x, lf)), c);
+		unsigned int bits = (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(m, c));
+		if (!utf8through) {
+			bits |= (unsigned int)_mm256_movemask_epi8(x);
+		}
+		if (bits) return p + ctz32(bits);
+		p += 32;
+	}
+	return find_escape_sse2(p, end, utf8through);
+}
+#endif
+
+// returns the first byte in [p, end) that html_encode escapes, or end
+static inline char const *find_escape(char const *p, char const *end, bool utf8through)
+{
+#ifdef XSTREAM_SIMD_X86
+	switch (level()) {
+	case AVX2:
+		return find_escape_avx2(p, end, utf8through);
+	case SSE2:
+		return find_escape_sse2(p, end, utf8through);
+	default:
+		break;
+	}
+#endif
+	return find_escape_scalar(p, end, utf8through);
+}
+
+// returns the first occurrence of s[0..n) in [p, end), or end
+static inline char const *find(char const *p, char const *end, char const *s, size_t n)
+{
+	if (p >= end || (size_t)(end - p) < n) return end;
+	char const *last = end - n + 1;
+	while (1) {
+		p = find(p, last, s[0]);
+		if (p == last) return end;
+		if (memcmp(p, s, n) == 0) return p;
+		p++;
+	}
+}
+
+// returns the '>' closing the tag at p, skipping quoted attribute values, or end
+static inline char const *find_tag_end(char const *p, char const *end)
+{
+	char quote = 0;
+#ifdef XSTREAM_SIMD_X86
+	if (level() != Scalar) {
+		// walk the '>' and quote positions of each 16 byte block in order
+		__m128i const vgt = _mm_set1_epi8('>');
+		__m128i const vdq = _mm_set1_epi8('\"');
+		__m128i const vsq = _mm_set1_epi8('\'');
+		while (end - p >= 16) {
+			__m128i x = _mm_loadu_si128((__m128i const *)p);
+			unsigned int gt = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(x, vgt));
+			unsigned int dq = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(x, vdq));
+			unsigned int sq = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(x, vsq));
+			unsigned int todo = 0xffff;
+			while (1) {
+				unsigned int m = (quote ? (quote == '\"' ? dq : sq) : (gt | dq | sq)) & todo;
+				if (!m) break;
+				int i = ctz32(m);
+				if (quote) {
+					quote = 0;
+				} else if (gt & (1u << i)) {
+					return p + i;
+				} else {
+					quote = p[i];
+				}
+				todo &= ~((2u << i) - 1);
 			}
+			p += 16;
 		}
 	}
+#endif
+	for (; p < end; p++) {
+		char c = *p;
+		if (quote) {
+			if (c == quote) quote = 0;
+		} else if (c == '>') {
+			return p;
+		} else if (c == '\"' || c == '\'') {
+			quote = c;
+		}
+	}
+	return end;
 }
 
-static inline std::string html_encode(std::string_view const &str, bool utf8through = true)
+#ifdef XSTREAM_SIMD_X86
+// base64 encodes 24 bytes to 32 digits per step while 28 bytes are readable; returns the bytes consumed
+XSTREAM_TARGET_AVX2 static inline size_t base64_encode_avx2(unsigned char const *p, size_t n, char *out)
 {
-	char const *begin = str.data();
-	char const *end = begin + str.size();
-	char const *ptr = begin;
-	while (ptr < end) {
-		int c = (unsigned char)*ptr;
-		if (isspace(c) || strchr("&<>\"\'", c)) {
-			break;
+	// spread each 3 bytes over 4 bytes, then move each 6 bit field into a byte of its own
+	__m256i const spread = _mm256_setr_epi8(
+		1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+		1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+	// the offset from a 6 bit value to its digit, by range: 0-25 at 13, 26-51 at 0, 52-61 at 1-10, 62, 63
+	__m256i const offsets = _mm256_setr_epi8(
+		'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+		'0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+		'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+		'0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+	size_t i = 0;
+	for (; i + 28 <= n; i += 24) {
+		__m128i lo = _mm_loadu_si128((__m128i const *)(p + i));
+		__m128i hi = _mm_loadu_si128((__m128i const *)(p + i + 12));
+		__m256i x = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1), spread);
+		__m256i a = _mm256_mulhi_epu16(_mm256_and_si256(x, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+		__m256i b = _mm256_mullo_epi16(_mm256_and_si256(x, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+		__m256i v = _mm256_or_si256(a, b);
+		__m256i range = _mm256_subs_epu8(v, _mm256_set1_epi8(51));
+		range = _mm256_or_si256(range, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), v), _mm256_set1_epi8(13)));
+		_mm256_storeu_si256((__m256i *)out, _mm256_add_epi8(v, _mm256_shuffle_epi8(offsets, range)));
+		out += 32;
+	}
+	return i;
+}
+
+// base64 decodes 32 digits to 24 bytes per step up to the first block holding anything else; returns where it stopped
+XSTREAM_TARGET_AVX2 static inline char const *base64_decode_avx2(char const *p, char const *end, char **out)
+{
+	// a byte is a digit if the bits looked up by its low and high nibbles do not intersect
+	__m256i const lut_lo = _mm256_setr_epi8(
+		0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+		0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+	__m256i const lut_hi = _mm256_setr_epi8(
+		0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+		0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+	// the offset from a digit to its value, by high nibble ('/' at 1)
+	__m256i const lut_roll = _mm256_setr_epi8(
+		0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+	__m256i const pack = _mm256_setr_epi8(
+		2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+		2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+	__m256i const mask = _mm256_set1_epi8(0x2f);
+	char *o = *out;
+	while (end - p >= 32) {
+		__m256i x = _mm256_loadu_si256((__m256i const *)p);
+		__m256i hi = _mm256_and_si256(_mm256_srli_epi32(x, 4), mask);
+		__m256i lo = _mm256_and_si256(x, mask);
+		if (!_mm256_testz_si256(_mm256_shuffle_epi8(lut_lo, lo), _mm256_shuffle_epi8(lut_hi, hi))) break;
+		__m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(_mm256_cmpeq_epi8(x, mask), hi));
+		x = _mm256_add_epi8(x, roll);
+		x = _mm256_maddubs_epi16(x, _mm256_set1_epi32(0x01400140));
+		x = _mm256_madd_epi16(x, _mm256_set1_epi32(0x00011000));
+		x = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(x, pack), _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+		_mm_storeu_si128((__m128i *)o, _mm256_castsi256_si128(x));
+		_mm_storel_epi64((__m128i *)(o + 16), _mm256_extracti128_si256(x, 1));
+		o += 24;
+		p += 32;
+	}
+	*out = o;
+	return p;
+}
+#endif
+
+} // namespace simd
+
+// the reference html_encode writes for each byte
+struct EscapeTable {
+	char str[256][7] = {};
+	unsigned char len[256] = {};
+	constexpr EscapeTable()
+	{
+		for (int c = 0; c < 256; c++) {
+			char const *name = nullptr;
+			switch (c) {
+			case '&': name = "&amp;"; break;
+			case '<': name = "&lt;"; break;
+			case '>': name = "&gt;"; break;
+			case '\"': name = "&quot;"; break;
+			case '\'': name = "&apos;"; break;
+			}
+			int n = 0;
+			if (name) {
+				while (name[n]) {
+					str[c][n] = name[n];
+					n++;
+				}
+			} else {
+				str[c][n++] = '&';
+				str[c][n++] = '#';
+				if (c >= 100) str[c][n++] = (char)('0' + c / 100);
+				if (c >= 10) str[c][n++] = (char)('0' + c / 10 % 10);
+				str[c][n++] = (char)('0' + c % 10);
+				str[c][n++] = ';';
+			}
+			len[c] = (unsigned char)n;
 		}
-		ptr++;
 	}
-	if (ptr == end) {
-		return (std::string)str;
+};
+
+static constexpr EscapeTable escape_table_{};
+
+// calls append(p, n) for each clean run and each reference of the escaped [ptr, end)
+template <typename Append> static inline void html_encode_runs_(char const *ptr, char const *end, bool utf8through, Append append)
+{
+	while (1) {
+		char const *next = simd::find_escape(ptr, end, utf8through);
+		if (next > ptr) {
+			append(ptr, next - ptr);
+		}
+		if (next == end) break;
+		unsigned char c = *next;
+		append(escape_table_.str[c], escape_table_.len[c]);
+		ptr = next + 1;
 	}
-	std::vector<char> vec;
-	vec.reserve(str.size() * 2);
-	vec.insert(vec.end(), begin, ptr);
-	html_encode_(ptr, end, utf8through, &vec);
-	begin = &vec[0];
-	end = begin + vec.size();
-	return std::string(begin, end);
 }
 
-static inline void html_decode_(char const *ptr, char const *end, std::vector<char> *vec)
+/**
+ * @brief Escapes [ptr, end) for use in text or attribute values and appends it to out.
+ *
+ * Runs of bytes that need no escaping are appended in bulk. out is any
+ * container with insert(end, first, last), such as std::string or std::vector<char>.
+ */
+template <typename Container> static inline void html_encode_(char const *ptr, char const *end, bool utf8through, Container *out)
 {
-	while (ptr < end) {
-		int c = *ptr & 0xff;
-		ptr++;
-		if (c == '&') {
-			char const *next = strchr(ptr, ';');
-			if (!next) {
-				break;
+	html_encode_runs_(ptr, end, utf8through, [out](char const *p, size_t n){
+		out->insert(out->end(), p, p + n);
+	});
+}
+
+// writes the UTF-8 encoding of the code point u
+template <typename OutputIt> static inline OutputIt utf8_encode_(uint32_t u, OutputIt out)
+{
+	if (u < 0x80) {
+		*out++ = (char)u;
+	} else if (u < 0x800) {
+		*out++ = (char)(0xc0 | (u >> 6));
+		*out++ = (char)(0x80 | (u & 0x3f));
+	} else if (u < 0x10000) {
+		*out++ = (char)(0xe0 | (u >> 12));
+		*out++ = (char)(0x80 | ((u >> 6) & 0x3f));
+		*out++ = (char)(0x80 | (u & 0x3f));
+	} else {
+		*out++ = (char)(0xf0 | (u >> 18));
+		*out++ = (char)(0x80 | ((u >> 12) & 0x3f));
+		*out++ = (char)(0x80 | ((u >> 6) & 0x3f));
+		*out++ = (char)(0x80 | (u & 0x3f));
+	}
+	return out;
+}
+
+// parses the reference starting at the '&' at ptr; returns the position after its ';', or nullptr if it is not a valid reference
+static inline char const *html_entity_(char const *ptr, char const *end, uint32_t *u)
+{
+	// the longest reference accepted is "&#x0010FFFF;"
+	char const *limit = end - ptr > 12 ? ptr + 12 : end;
+	char const *p = ptr + 1;
+	char const *semi = (char const *)memchr(p, ';', limit - p);
+	if (!semi) return nullptr;
+	size_t n = semi - p;
+	if (n >= 2 && p[0] == '#') {
+		uint32_t v = 0;
+		if (p[1] == 'x' || p[1] == 'X') {
+			if (n < 3) return nullptr;
+			for (p += 2; p < semi; p++) {
+				int c = *p | 0x20;
+				if (*p >= '0' && *p <= '9') {
+					v = v * 16 + (*p - '0');
+				} else if (c >= 'a' && c <= 'f') {
+					v = v * 16 + (c - 'a' + 10);
+				} else {
+					return nullptr;
+				}
+			}
+		} else {
+			for (p++; p < semi; p++) {
+				if (*p < '0' || *p > '9') return nullptr;
+				v = v * 10 + (*p - '0');
 			}
-			std::string t(ptr, next);
-			if (t[0] == '#') {
-				c = atoi(t.c_str() + 1);
-				vecprint(vec, c);
-			} else if (t == "amp") {
-				vecprint(vec, '&');
-			} else if (t == "lt") {
-				vecprint(vec, '<');
-			} else if (t == "gt") {
-				vecprint(vec, '>');
-			} else if (t == "quot") {
-				vecprint(vec, '\"');
-			} else if (t == "apos") {
-				vecprint(vec, '\'');
-			}
-			ptr = next + 1;
+		}
+		if (v == 0 || v > 0x10ffff || (v >= 0xd800 && v < 0xe000)) return nullptr;
+		*u = v;
+		return semi + 1;
+	}
+	switch (n) {
+	case 2:
+		if (p[1] != 't') return nullptr;
+		if (p[0] == 'l') {
+			*u = '<';
+		} else if (p[0] == 'g') {
+			*u = '>';
 		} else {
-			vecprint(vec, c);
+			return nullptr;
 		}
+		break;
+	case 3:
+		if (memcmp(p, "amp", 3) != 0) return nullptr;
+		*u = '&';
+		break;
+	case 4:
+		if (memcmp(p, "quot", 4) == 0) {
+			*u = '\"';
+		} else if (memcmp(p, "apos", 4) == 0) {
+			*u = '\'';
+		} else {
+			return nullptr;
+		}
+		break;
+	default:
+		return nullptr;
 	}
+	return semi + 1;
 }
 
-static inline std::string html_decode(std::string_view const &str)
+// calls fn(std::string_view) with the decoded text of [ptr, end) in pieces: runs without references and single decoded references
+template <typename F> static inline void html_decode_chunks_(char const *ptr, char const *end, F fn)
 {
-	char const *begin = str.data();
-	char const *end = begin + str.size();
-	char const *ptr = begin;
-	while (ptr < end) {
-		int c = (unsigned char)*ptr;
-		if (c == '&') {
+	char const *run = ptr;
+	while (1) {
+		char const *amp = simd::find(ptr, end, '&');
+		if (amp == end) {
+			if (run < end) {
+				fn(std::string_view(run, end - run));
+			}
 			break;
 		}
-		ptr++;
+		uint32_t u;
+		char const *next = html_entity_(amp, end, &u);
+		if (!next) {
+			ptr = amp + 1; // kept in the run as it is
+			continue;
+		}
+		if (run < amp) {
+			fn(std::string_view(run, amp - run));
+		}
+		char buf[4];
+		fn(std::string_view(buf, utf8_encode_(u, buf) - buf));
+		ptr = run = next;
 	}
+}
+
+/**
+ * @brief Decodes the character and entity references in [ptr, end) to out.
+ *
+ * Never reads outside [ptr, end) and never allocates. The output is never
+ * longer than the input, so a buffer of end - ptr bytes is always enough.
+ * Numeric references are written as UTF-8; unknown or malformed references
+ * are copied as they are.
+ * @return The end of the output.
+ */
+template <typename OutputIt> static inline OutputIt html_decode_to(char const *ptr, char const *end, OutputIt out)
+{
+	while (1) {
+		char const *amp = simd::find(ptr, end, '&');
+		out = std::copy(ptr, amp, out);
+		if (amp == end) break;
+		uint32_t u;
+		char const *next = html_entity_(amp, end, &u);
+		if (next) {
+			out = utf8_encode_(u, out);
+			ptr = next;
+		} else {
+			*out++ = '&';
+			ptr = amp + 1;
+		}
+	}
+	return out;
+}
+
+static constexpr char base64_digits_[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// the value of each base64 digit
+struct Base64Table {
+	enum {
+		Invalid = -1,
+		Space = -2,
+		Pad = -3,
+	};
+	signed char value[256] = {};
+	constexpr Base64Table()
+	{
+		for (int c = 0; c < 256; c++) {
+			value[c] = Invalid;
+		}
+		for (int i = 0; i < 64; i++) {
+			value[(unsigned char)base64_digits_[i]] = (signed char)i;
+		}
+		value[(unsigned char)' '] = value[(unsigned char)'\t'] = value[(unsigned char)'\r'] = value[(unsigned char)'\n'] = Space;
+		value[(unsigned char)'='] = Pad;
+	}
+};
+
+static constexpr Base64Table base64_table_{};
+
+/**
+ * @brief Writes the base64 encoding of data[0..n) to out.
+ *
+ * out must have room for base64_encoded_size(n) characters.
+ * @return The end of the output.
+ */
+static inline char *base64_encode_to(void const *data, size_t n, char *out)
+{
+	unsigned char const *p = (unsigned char const *)data;
+	size_t i = 0;
+#ifdef XSTREAM_SIMD_X86
+	if (simd::level() == simd::AVX2) {
+		i = simd::base64_encode_avx2(p, n, out);
+		out += i / 3 * 4;
+	}
+#endif
+	for (; i + 3 <= n; i += 3) {
+		uint32_t v = (uint32_t)p[i] << 16 | (uint32_t)p[i + 1] << 8 | p[i + 2];
+		*out++ = base64_digits_[v >> 18];
+		*out++ = base64_digits_[(v >> 12) & 0x3f];
+		*out++ = base64_digits_[(v >> 6) & 0x3f];
+		*out++ = base64_digits_[v & 0x3f];
+	}
+	if (i < n) {
+		uint32_t v = (uint32_t)p[i] << 16 | (i + 1 < n ? (uint32_t)p[i + 1] << 8 : 0);
+		*out++ = base64_digits_[v >> 18];
+		*out++ = base64_digits_[(v >> 12) & 0x3f];
+		*out++ = i + 1 < n ? base64_digits_[(v >> 6) & 0x3f] : '=';
+		*out++ = '=';
+	}
+	return out;
+}
+
+static inline size_t base64_encoded_size(size_t n)
+{
+	return (n + 2) / 3 * 4;
+}
+
+/**
+ * @brief Decodes base64 given in any number of pieces, skipping whitespace.
+ *
+ * decode() writes each group of three bytes as soon as its four digits
+ * are in, and finish() writes what is left of a padded or unpadded last
+ * group. Both return the end of the output, or nullptr once the input has
+ * turned out not to be base64. Blocks of 32 digits are decoded with AVX2
+ * when available.
+ */
+class Base64Decoder {
+private:
+	uint32_t bits_ = 0;
+	int count_ = 0; // digits in bits_
+	int pad_ = 0; // '=' seen
+	bool failed_ = false;
+	char *fail()
+	{
+		failed_ = true;
+		return nullptr;
+	}
+public:
+	// output needed for n more characters of input, including what finish() writes
+	static size_t max_decoded_size(size_t n)
+	{
+		return n / 4 * 3 + 3;
+	}
+	char *decode(char const *p, char const *end, char *out)
+	{
+		if (failed_) return nullptr;
+		while (p < end) {
+#ifdef XSTREAM_SIMD_X86
+			if (count_ == 0 && pad_ == 0 && simd::level() == simd::AVX2) {
+				p = simd::base64_decode_avx2(p, end, &out);
+				if (p == end) break;
+			}
+#endif
+			// a block with whitespace or padding, or the tail; then realign to a group for the next block
+			char const *stop = end - p > 32 ? p + 32 : end;
+			for (; p < end && (p < stop || count_ != 0); p++) {
+				int v = base64_table_.value[(unsigned char)*p];
+				if (v >= 0) {
+					if (pad_ > 0) return fail();
+					bits_ = bits_ << 6 | v;
+					if (++count_ == 4) {
+						*out++ = (char)(bits_ >> 16);
+						*out++ = (char)(bits_ >> 8);
+						*out++ = (char)bits_;
+						bits_ = 0;
+						count_ = 0;
+					}
+				} else if (v == Base64Table::Pad) {
+					if (count_ < 2 || count_ + ++pad_ > 4) return fail();
+				} else if (v != Base64Table::Space) {
+					return fail();
+				}
+			}
+		}
+		return out;
+	}
+	char *decode(std::string_view const &s, char *out)
+	{
+		return decode(s.data(), s.data() + s.size(), out);
+	}
+	char *finish(char *out)
+	{
+		if (failed_ || count_ == 1 || (pad_ > 0 && count_ + pad_ != 4)) return fail();
+		if (count_ == 2) {
+			*out++ = (char)(bits_ >> 4);
+		} else if (count_ == 3) {
+			*out++ = (char)(bits_ >> 10);
+			*out++ = (char)(bits_ >> 2);
+		}
+		*this = {};
+		return out;
+	}
+};
+
+#ifdef __HTMLENCODE_H
+
+inline std::string html_encode(std::string_view const &str)
+{
+	return ::html_encode(str, true);
+
+}
+
+inline std::string html_decode(std::string_view const &str)
+{
+	return ::html_decode(str);
+}
+
+#else
+
+static inline std::string html_encode(std::string_view const &str, bool utf8through = true)
+{
+	char const *begin = str.data();
+	char const *end = begin + str.size();
+	char const *ptr = simd::find_escape(begin, end, utf8through);
 	if (ptr == end) {
 		return (std::string)str;
 	}
-	std::vector<char> vec;
-	vec.reserve(str.size() * 2);
-	vec.insert(vec.end(), begin, ptr);
-	html_decode_(ptr, end, &vec);
-	begin = &vec[0];
-	end = begin + vec.size();
-	return std::string(begin, end);
+	std::string s;
+	s.reserve(str.size() + str.size() / 4 + 16);
+	s.assign(begin, ptr);
+	html_encode_(ptr, end, utf8through, &s);
+	return s;
+}
+
+static inline void html_decode_(char const *ptr, char const *end, std::vector<char> *vec)
+{
+	size_t n = vec->size();
+	vec->resize(n + (end - ptr));
+	char *e = html_decode_to(ptr, end, vec->data() + n);
+	vec->resize(e - vec->data());
+}
+
+static inline std::string html_decode(std::string_view const &str)
+{
+	std::string s(str.size(), 0);
+	s.resize(html_decode_to(str.data(), str.data() + str.size(), &s[0]) - s.data());
+	return s;
 }
 
 #endif // __HTMLENCODE_H
 
-class Reader {
+#ifndef XSTREAM_NO_MMAP
+
+/**
+ * @brief Read-only memory mapping of a whole file.
+ */
+class MappedFile {
+public:
+	enum Flag {
+		Sequential = 0x01, // advise the kernel to read ahead aggressively
+		HugePages = 0x02, // ask for transparent huge pages where supported
+		Populate = 0x04, // prefault the whole mapping up front
+	};
+private:
+	char const *data_ = nullptr;
+	size_t size_ = 0;
+#ifdef _WIN32
+	HANDLE map_ = nullptr;
+#endif
+public:
+	MappedFile() = default;
+	MappedFile(MappedFile const &) = delete;
+	MappedFile &operator = (MappedFile const &) = delete;
+	~MappedFile()
+	{
+		close();
+	}
+	bool open(char const *path, int flags = Sequential)
+	{
+		close();
+#ifdef _WIN32
+		(void)flags;
+		HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return false;
+		LARGE_INTEGER size;
+		bool ok = GetFileSizeEx(file, &size) != 0;
+		if (ok && size.QuadPart > 0) {
+			map_ = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (map_) {
+				data_ = (char const *)MapViewOfFile(map_, FILE_MAP_READ, 0, 0, 0);
+				size_ = (size_t)size.QuadPart;
+			}
+			ok = data_ != nullptr;
+		}
+		CloseHandle(file);
+		if (!ok) close();
+		return ok;
+#else
+		int fd = ::open(path, O_RDONLY);
+		if (fd == -1) return false;
+		struct stat st;
+		bool ok = fstat(fd, &st) == 0;
+		if (ok && st.st_size > 0) {
+			int mflags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+			if (flags & Populate) {
+				mflags |= MAP_POPULATE;
+			}
+#endif
+			void *p = mmap(nullptr, (size_t)st.st_size, PROT_READ, mflags, fd, 0);
+			if (p != MAP_FAILED) {
+				data_ = (char const *)p;
+				size_ = (size_t)st.st_size;
+				if (flags & Sequential) {
+					madvise(p, size_, MADV_SEQUENTIAL);
+				}
+#ifdef MADV_HUGEPAGE
+				if (flags & HugePages) {
+					madvise(p, size_, MADV_HUGEPAGE);
+				}
+#endif
+			}
+			ok = data_ != nullptr;
+		}
+		::close(fd);
+		return ok;
+#endif
+	}
+	void close()
+	{
+#ifdef _WIN32
+		if (data_) UnmapViewOfFile(data_);
+		if (map_) CloseHandle(map_);
+		map_ = nullptr;
+#else
+		if (data_) munmap((void *)data_, size_);
+#endif
+		data_ = nullptr;
+		size_ = 0;
+	}
+	char const *data() const
+	{
+		return data_;
+	}
+	size_t size() const
+	{
+		return size_;
+	}
+};
+
+#endif // XSTREAM_NO_MMAP
+
+// 64-bit FNV-1a, continued from h
+static constexpr uint64_t fnv1a(uint64_t h, char const *p, size_t n)
+{
+	for (size_t i = 0; i < n; i++) {
+		h = (h ^ (unsigned char)p[i]) * 0x100000001b3ULL;
+	}
+	return h;
+}
+
+static constexpr uint64_t FNV1A_BASIS = 0xcbf29ce484222325ULL;
+
+/**
+ * @brief An absolute path fixed at compile time.
+ *
+ * Matching a StaticPath costs one hash comparison per call; the reader keeps
+ * the hash of the current path up to date as elements are entered.
+ * @code
+ * static constexpr xstream::StaticPath ITEM = "/root/item";
+ * if (r.match_start(ITEM)) ...
+ * @endcode
+ */
+class StaticPath {
+private:
+	char const *str_;
+	size_t size_;
+	uint64_t hash_;
+	static constexpr size_t length(char const *s)
+	{
+		size_t n = 0;
+		while (s[n]) n++;
+		if (n > 0 && s[n - 1] == '/') n--; // "/a/" is the same as "/a"
+		return n;
+	}
+public:
+	constexpr StaticPath(char const *s)
+		: str_(s)
+		, size_(length(s))
+		, hash_(fnv1a(FNV1A_BASIS, s, length(s)))
+	{
+	}
+	constexpr char const *data() const
+	{
+		return str_;
+	}
+	constexpr size_t size() const
+	{
+		return size_;
+	}
+	constexpr uint64_t hash() const
+	{
+		return hash_;
+	}
+};
+
+/**
+ * @brief A set of path patterns compiled into a deterministic automaton.
+ *
+ * Patterns look like absolute paths ("/root/item"). A "*" step matches any
+ * single element and "//" matches any number of elements in between
+ * ("//item", "/root//name"). A pattern that does not start with '/' matches
+ * at any depth. The reader makes one transition per start element, so the
+ * cost of finding the patterns that match the current element does not
+ * depend on how many patterns there are.
+ *
+ * The set must not be modified while a reader is using it.
+ */
+class PathSet {
+public:
+	class Matches {
+	private:
+		int const *begin_ = nullptr;
+		int const *end_ = nullptr;
+	public:
+		Matches() = default;
+		Matches(int const *begin, int const *end)
+			: begin_(begin)
+			, end_(end)
+		{
+		}
+		int const *begin() const
+		{
+			return begin_;
+		}
+		int const *end() const
+		{
+			return end_;
+		}
+		size_t size() const
+		{
+			return end_ - begin_;
+		}
+		bool empty() const
+		{
+			return begin_ == end_;
+		}
+		bool contains(int id) const
+		{
+			for (int i : *this) {
+				if (i == id) return true;
+			}
+			return false;
+		}
+	};
+private:
+	struct Step {
+		int symbol; // index into names_, -1 for "*"
+		bool descendant; // preceded by "//"
+	};
+	std::vector<std::vector<Step>> patterns_;
+	std::vector<std::string> names_;
+	std::vector<int> slots_; // open addressing hash table of names_
+	std::vector<int> next_; // transitions, state * (names_.size() + 1) + symbol
+	std::vector<int> match_offsets_; // per state, range in match_ids_
+	std::vector<int> match_ids_;
+
+	int find_name(std::string_view const &name) const
+	{
+		if (slots_.empty()) return (int)names_.size();
+		size_t mask = slots_.size() - 1;
+		size_t i = (size_t)fnv1a(FNV1A_BASIS, name.data(), name.size()) & mask;
+		while (slots_[i] >= 0) {
+			if (names_[slots_[i]] == name) return slots_[i];
+			i = (i + 1) & mask;
+		}
+		return (int)names_.size();
+	}
+	int intern(std::string_view const &name)
+	{
+		int id = find_name(name);
+		if (id < (int)names_.size()) return id;
+		names_.emplace_back(name);
+		size_t n = 16;
+		while (n < names_.size() * 2) n *= 2;
+		slots_.assign(n, -1);
+		for (size_t j = 0; j < names_.size(); j++) {
+			size_t i = (size_t)fnv1a(FNV1A_BASIS, names_[j].data(), names_[j].size()) & (n - 1);
+			while (slots_[i] >= 0) {
+				i = (i + 1) & (n - 1);
+			}
+			slots_[i] = (int)j;
+		}
+		return id;
+	}
+	void compile()
+	{
+		// subset construction over (pattern, matched steps) pairs
+		typedef std::vector<std::pair<int, int>> Set;
+		size_t symbols = names_.size() + 1;
+		std::map<Set, int> ids;
+		std::vector<Set> sets;
+		Set start;
+		for (size_t p = 0; p < patterns_.size(); p++) {
+			start.emplace_back((int)p, 0);
+		}
+		ids[start] = 0;
+		sets.push_back(start);
+		next_.clear();
+		match_offsets_.assign(1, 0);
+		match_ids_.clear();
+		for (size_t state = 0; state < sets.size(); state++) {
+			for (auto const &e : sets[state]) {
+				if (e.second == (int)patterns_[e.first].size()) {
+					match_ids_.push_back(e.first);
+				}
+			}
+			match_offsets_.push_back((int)match_ids_.size());
+			for (size_t a = 0; a < symbols; a++) {
+				Set t;
+				for (auto const &e : sets[state]) {
+					auto const &steps = patterns_[e.first];
+					if (e.second < (int)steps.size()) {
+						Step const &step = steps[e.second];
+						if (step.descendant) {
+							t.push_back(e);
+						}
+						if (step.symbol < 0 || step.symbol == (int)a) {
+							t.emplace_back(e.first, e.second + 1);
+						}
+					}
+				}
+				std::sort(t.begin(), t.end());
+				t.erase(std::unique(t.begin(), t.end()), t.end());
+				auto it = ids.find(t);
+				int to;
+				if (it != ids.end()) {
+					to = it->second;
+				} else {
+					to = (int)sets.size();
+					ids[t] = to;
+					sets.push_back(std::move(t));
+				}
+				next_.push_back(to);
+			}
+		}
+	}
+public:
+	PathSet()
+	{
+		compile();
+	}
+	PathSet(std::initializer_list<char const *> patterns)
+	{
+		for (char const *p : patterns) {
+			patterns_.push_back(parse(p));
+		}
+		compile();
+	}
+	/**
+	 * @brief Adds a pattern.
+	 * @return the pattern id, assigned in order from 0
+	 */
+	int add(std::string_view const &pattern)
+	{
+		patterns_.push_back(parse(pattern));
+		compile();
+		return (int)patterns_.size() - 1;
+	}
+	size_t size() const
+	{
+		return patterns_.size();
+	}
+	int start() const
+	{
+		return 0;
+	}
+	int next(int state, std::string_view const &name) const
+	{
+		return next_[state * (names_.size() + 1) + find_name(name)];
+	}
+	Matches matches(int state) const
+	{
+		int const *ids = match_ids_.data();
+		return {ids + match_offsets_[state], ids + match_offsets_[state + 1]};
+	}
+private:
+	std::vector<Step> parse(std::string_view const &s)
+	{
+		std::vector<Step> steps;
+		bool descendant = s.empty() || s[0] != '/';
+		size_t i = 0;
+		while (i < s.size()) {
+			if (s[i] == '/') {
+				i++;
+				if (i < s.size() && s[i] == '/') {
+					descendant = true;
+					i++;
+				}
+				continue;
+			}
+			size_t j = s.find('/', i);
+			if (j == std::string_view::npos) {
+				j = s.size();
+			}
+			std::string_view name = s.substr(i, j - i);
+			steps.push_back({name == "*" ? -1 : intern(name), descendant});
+			descendant = false;
+			i = j;
+		}
+		return steps;
+	}
+};
+
+#ifdef XSTREAM_STATS
+static constexpr bool stats_enabled = true;
+#else
+static constexpr bool stats_enabled = false; // Reader::stats() stays zero and counting compiles away
+#endif
+
+/**
+ * @brief The features of a BasicReader, all on; derive and override to turn some off.
+ *
+ * A feature that is off costs nothing in next(), and the members that
+ * depend on it fail to compile instead of returning wrong results:
+ * @code
+ * struct Events : xstream::ReaderPolicy {
+ * 	static constexpr bool paths = false;
+ * 	static constexpr bool text = false;
+ * };
+ * xstream::BasicReader<Events> r(xml);
+ * @endcode
+ */
+struct ReaderPolicy {
+	static constexpr bool paths = true; // path(), match_*(), set_paths(), set_context(); without it end tags are assumed to match
+	static constexpr bool text = true; // text() collects the character data of each element; characters() works either way
+	static constexpr bool comments = true; // Comment events; without it comments are skipped
+	static constexpr bool attributes = true; // attribute(), attributes(), for_each_attribute()
+	static constexpr bool nesting = true; // nest() and hold()
+	static constexpr bool stats = stats_enabled; // stats()
+};
+
+/**
+ * @brief The event types and counters shared by every BasicReader.
+ */
+class ReaderBase {
+public:
+	enum StateType {
+		None,
+		Error,
+		Comment,
+		StartElement,
+		EndElement,
+		Characters,
+		Declaration,
+		NeedMore,
+	};
+	/**
+	 * @brief Counters kept by the reader when XSTREAM_STATS is defined; see stats().
+	 */
+	struct Stats {
+		uint64_t bytes = 0; // input consumed by next()
+		uint64_t events[NeedMore + 1] = {}; // by StateType
+		uint64_t attributes = 0; // attributes tokenized
+		uint64_t entities = 0; // references in the text decoded by text() and attribute(name, defval)
+		uint64_t cdata_bytes = 0;
+		uint64_t comment_bytes = 0;
+		uint64_t allocations = 0; // growths of the reader's own buffers
+		uint32_t max_depth = 0; // peak depth()
+		uint32_t max_parts = 0; // peak number of text parts held by one element
+		Stats &operator += (Stats const &o)
+		{
+			bytes += o.bytes;
+			for (int i = 0; i <= NeedMore; i++) {
+				events[i] += o.events[i];
+			}
+			attributes += o.attributes;
+			entities += o.entities;
+			cdata_bytes += o.cdata_bytes;
+			comment_bytes += o.comment_bytes;
+			allocations += o.allocations;
+			max_depth = std::max(max_depth, o.max_depth);
+			max_parts = std::max(max_parts, o.max_parts);
+			return *this;
+		}
+	};
+};
+
+template <typename Policy> class BasicReader : public ReaderBase {
 private:
 
 	static inline void vecprint(std::vector<char> *out, char c)
@@ -183,16 +1199,6 @@ private:
 		return {};
 	}
 
-public:
-	enum StateType {
-		None,
-		Error,
-		Comment,
-		StartElement,
-		EndElement,
-		Characters,
-		Declaration
-	};
 private:
 	char const *begin_ = nullptr;
 	char const *end_ = nullptr;
@@ -201,6 +1207,24 @@ private:
 	StateType state_ = None;
 	bool next_end_element_ = false;
 	std::string_view element_name_;
+	bool final_ = true; // false while feed() may still append input
+	std::vector<char> buffer_; // push mode: input not yet consumed
+	std::string pinned_name_;
+	bool lazy_attributes_ = false;
+	size_t text_chunk_ = 0; // set_text_chunk_size()
+	size_t push_text_limit_ = 1 << 20; // set_push_text_limit()
+	bool cdata_ = false; // inside a CDATA section reported in pieces
+	size_t scanned_ = 0; // push mode: bytes after ptr_ known not to finish the pending token
+	size_t skip_depth_ = 0; // skip_element(): open elements left to skip
+	char const *end_tag_ = nullptr; // EndElement: the '<' of the end tag, or the end of an empty element
+	// outer_xml() on a StartElement: the end tag found for the element starting at close_from_
+	mutable char const *close_from_ = nullptr;
+	mutable char const *close_lt_ = nullptr;
+	mutable char const *close_end_ = nullptr;
+	mutable Stats stats_;
+#ifndef XSTREAM_NO_MMAP
+	std::shared_ptr<MappedFile> file_;
+#endif
 	struct CharPart {
 		enum Type {
 			Text,
@@ -219,38 +1243,43 @@ private:
 		{
 			return type_;
 		}
-		std::vector<char> decode() const
+		std::string_view raw() const
+		{
+			return sv_;
+		}
+		template <typename OutputIt> OutputIt decode_to(OutputIt out) const
 		{
 			if (type_ == Text) {
-				std::vector<char> v;
-				html_decode_(sv_.data(), sv_.data() + sv_.size(), &v);
-				return v;
+				return html_decode_to(sv_.data(), sv_.data() + sv_.size(), out);
 			} else if (type_ == CDATA) {
-				return std::vector<char>(sv_.data(), sv_.data() + sv_.size());
+				return std::copy(sv_.begin(), sv_.end(), out);
 			}
-			return {};
+			return out;
+		}
+		std::vector<char> decode() const
+		{
+			std::vector<char> v(type_ == Comment ? 0 : sv_.size());
+			v.resize(decode_to(v.data()) - v.data());
+			return v;
 		}
 	};
 public:
 	class EncodedCharacters {
-		friend class Reader;
+		friend class BasicReader;
 	private:
 		std::vector<CharPart> chars_;
 		void clear()
 		{
 			chars_.clear();
 		}
-		void append(CharPart::Type type, char const *begin, char const *end)
+		void append(typename CharPart::Type type, char const *begin, char const *end)
 		{
 			if (begin != end) {
 				chars_.emplace_back(type, begin, end);
 			}
 		}
 	public:
-		EncodedCharacters()
-		{
-			chars_.reserve(16);
-		}
+		EncodedCharacters() = default;
 		void append(EncodedCharacters &&a)
 		{
 			EncodedCharacters b = std::move(a);
@@ -260,20 +1289,45 @@ public:
 		}
 		std::string to_string() const
 		{
-			std::vector<CharPart> const &parts = chars_;
-			std::vector<char> vec;
+			std::string s;
+			to_string(&s);
+			return s;
+		}
+		// decodes into *out, replacing its content and reusing its capacity
+		void to_string(std::string *out) const
+		{
 			size_t len = 0;
-			for (auto &part : parts) {
+			for (auto &part : chars_) {
 				len += part.sv_.size();
 			}
-			vec.reserve(len + 100);
-			for (auto &part : parts) {
-				std::vector<char> v = part.decode();
-				if (!v.empty()) {
-					vec.insert(vec.end(), v.begin(), v.end());
+			out->resize(len);
+			char *p = &(*out)[0];
+			for (auto &part : chars_) {
+				p = part.decode_to(p);
+			}
+			out->resize(p - out->data());
+		}
+		// the text as it is in the input, if that is also its decoded form
+		std::optional<std::string_view> view() const
+		{
+			std::string_view v;
+			for (auto &part : chars_) {
+				if (part.type_ == CharPart::Comment) continue;
+				if (!v.empty()) return std::nullopt;
+				if (part.type_ == CharPart::Text && memchr(part.sv_.data(), '&', part.sv_.size())) return std::nullopt;
+				v = part.sv_;
+			}
+			return v;
+		}
+		template <typename F> void for_each_chunk(F fn) const
+		{
+			for (auto &part : chars_) {
+				if (part.type_ == CharPart::Text) {
+					html_decode_chunks_(part.sv_.data(), part.sv_.data() + part.sv_.size(), fn);
+				} else if (part.type_ == CharPart::CDATA) {
+					fn(part.sv_);
 				}
 			}
-			return std::string(vec.data(), vec.size());
 		}
 	};
 	class EscapedAttributeValue {
@@ -289,25 +1343,167 @@ public:
 		{
 			return html_decode(sv_);
 		}
+		/**
+		 * @brief Decodes the value to out without allocating.
+		 * @return The end of the output; at most size() bytes are written.
+		 */
+		template <typename OutputIt> OutputIt decode_to(OutputIt out) const
+		{
+			return html_decode_to(sv_.data(), sv_.data() + sv_.size(), out);
+		}
+		size_t size() const
+		{
+			return sv_.size();
+		}
+		std::string_view raw() const
+		{
+			return sv_;
+		}
 		operator std::string () const
 		{
 			return to_string();
 		}
 	};
 private:
+	// push mode: copies of views out of the input buffer; blocks never move or shrink, so earlier copies stay valid
+	class PinStore {
+	private:
+		std::vector<std::vector<char>> blocks_; // each filled within its reserved capacity
+		size_t current_ = 0;
+	public:
+		void clear()
+		{
+			for (auto &b : blocks_) {
+				b.clear();
+			}
+			current_ = 0;
+		}
+		size_t blocks() const
+		{
+			return blocks_.size();
+		}
+		std::string_view copy(std::string_view const &s)
+		{
+			while (current_ < blocks_.size() && blocks_[current_].capacity() - blocks_[current_].size() < s.size()) {
+				current_++;
+			}
+			if (current_ == blocks_.size()) {
+				size_t last = blocks_.empty() ? 0 : blocks_.back().capacity();
+				blocks_.emplace_back();
+				blocks_.back().reserve(std::max({s.size(), last * 2, (size_t)256}));
+			}
+			std::vector<char> &b = blocks_[current_];
+			char const *p = b.data() + b.size();
+			b.insert(b.end(), s.begin(), s.end());
+			return {p, s.size()};
+		}
+	};
 	struct Tag {
-		std::string path;
-		std::vector<std::pair<std::string_view, std::string_view>> atts;
+		size_t path_size = 0; // length of path_ up to and including this element
+		uint64_t path_hash = FNV1A_BASIS; // of path_ up to and including this element
+		int path_state = 0; // state of paths_ after this element
+		mutable std::vector<std::pair<std::string_view, std::string_view>> atts;
+		std::string_view raw_atts; // lazy attributes: the untokenized span
+		mutable bool lazy = false; // raw_atts has not been tokenized yet
 		EncodedCharacters chars;
-		Tag() = default;
-		Tag(std::string const &path)
-			: path(path)
+		PinStore pinned; // push mode: copies of atts
+		PinStore pinned_text; // push mode: copies of chars
+		size_t pinned_text_size = 0; // bytes in pinned_text
+		size_t pinned_parts = 0; // chars parts before this are out of the input buffer
+		bool text_dropped = false; // push mode: chars went past push_text_limit_ and are no longer kept
+		char const *start = nullptr; // the '<' of the start tag; nullptr once dropped from the push buffer
+		char const *content = nullptr; // just after the start tag
+		void clear()
+		{
+			start = nullptr;
+			content = nullptr;
+			path_size = 0;
+			path_hash = FNV1A_BASIS;
+			path_state = 0;
+			atts.clear();
+			raw_atts = {};
+			lazy = false;
+			chars.clear();
+			pinned.clear();
+			pinned_text.clear();
+			pinned_text_size = 0;
+			pinned_parts = 0;
+			text_dropped = false;
+		}
+	};
+	class TagStack {
+	private:
+		// slots above size_ are kept so their buffers are reused
+		std::vector<Tag> tags_;
+		size_t size_ = 0;
+	public:
+		size_t size() const
+		{
+			return size_;
+		}
+		bool empty() const
+		{
+			return size_ == 0;
+		}
+		Tag &operator [] (size_t i)
+		{
+			return tags_[i];
+		}
+		Tag const &operator [] (size_t i) const
+		{
+			return tags_[i];
+		}
+		Tag &back()
+		{
+			return tags_[size_ - 1];
+		}
+		Tag const &back() const
+		{
+			return tags_[size_ - 1];
+		}
+		size_t capacity() const
 		{
+			return tags_.capacity();
+		}
+		Tag *begin()
+		{
+			return tags_.data();
+		}
+		Tag *end()
+		{
+			return tags_.data() + size_;
+		}
+		void clear()
+		{
+			size_ = 0;
+		}
+		void resize(size_t n)
+		{
+			assert(n <= size_);
+			size_ = n;
+		}
+		// the cleared slot push() will use next
+		Tag &spare()
+		{
+			if (size_ == tags_.size()) {
+				tags_.emplace_back();
+			}
+			Tag &tag = tags_[size_];
+			tag.clear();
+			return tag;
+		}
+		Tag &push()
+		{
+			assert(size_ < tags_.size());
+			return tags_[size_++];
 		}
 	};
-	std::vector<Tag> stack_;
-	std::string last_path_;
-	bool issymf(char c)
+	TagStack stack_;
+	CharPart part_; // without Policy::text: the part of the current Characters or Comment event
+	std::string path_; // path of stack_.back(), shared by all levels
+	std::string decl_path_; // path() of a declaration: its bare name, as it has no place in the tree
+	PathSet const *paths_ = nullptr;
+	static bool issymf(char c)
 	{
 		int d = (unsigned char)c;
 		if (d < 0x100) {
@@ -322,7 +1518,7 @@ private:
 		}
 		return true;
 	}
-	bool issym(char c)
+	static bool issym(char c)
 	{
 		int d = (unsigned char)c;
 		if (d < 0x100) {
@@ -337,35 +1533,173 @@ private:
 	void reset_stack()
 	{
 		stack_.clear();
-		stack_.push_back({});
-		last_path_.clear();
+		stack_.spare();
+		stack_.push();
+		path_.clear();
 	}
 	void init(char const *begin, char const *end)
 	{
 		begin_ = begin;
 		end_ = end;
 		ptr_ = begin_;
+		chars_ = nullptr;
+		state_ = None;
+		next_end_element_ = false;
+		element_name_ = {};
+		buffer_.clear();
+		scanned_ = 0;
+		skip_depth_ = 0;
+		end_tag_ = nullptr;
+		close_from_ = nullptr;
+		cdata_ = false;
+		part_ = {};
+		d.depth_stack.clear();
+		d.hold = false;
 		reset_stack();
 	}
 	std::string const &current_path() const
 	{
-		if (!last_path_.empty()) return last_path_;
-		if (stack_.empty()) return last_path_; // empty string
-		return stack_.back().path;
+		return state_ == Declaration ? decl_path_ : path_;
+	}
+	typedef std::vector<std::pair<std::string_view, std::string_view>> Attributes;
+	static char const *parse_attributes(char const *ptr, char const *end, Attributes *atts)
+	{
+		// tokenizes attributes up to the end of the tag; returns where it stopped
+		while (ptr < end && isspace((unsigned char)*ptr)) {
+			ptr++;
+			while (ptr < end && isspace((unsigned char)*ptr)) {
+				ptr++;
+			}
+			char const *eq = nullptr;
+			char quote = 0;
+			if (ptr < end && issymf(*ptr)) {
+				char const *left = ptr++;
+				while (1) {
+					if (!eq) {
+						if (ptr == end) {
+							break;
+						} else if (*ptr == '=') {
+							eq = ptr;
+							ptr++;
+							if (ptr < end) {
+								char q = *ptr;
+								if (q == '\'' || q == '\"') {
+									quote = q;
+									ptr++;
+								}
+							}
+						} else if (isspace((unsigned char)*ptr) || *ptr == '>' || *ptr == '/') {
+							break;
+						} else {
+							ptr++;
+						}
+					} else if (quote != 0 && ptr < end && *ptr != quote) {
+						ptr = simd::find(ptr, end, quote);
+					} else if (ptr == end || quote != 0 || isspace((unsigned char)*ptr) || *ptr == '>' || *ptr == '/') {
+						if (ptr < end && *ptr == quote) {
+							ptr++;
+						}
+						std::string_view key;
+						std::string_view val;
+						if (eq) {
+							key = std::string_view(left, eq - left);
+							char const *left = eq + 1;
+							char const *right = ptr;
+							if (left + 1 < right && left[0] == quote && right[-1] == quote) {
+								left++;
+								right--;
+							}
+							val = std::string_view(left, right - left);
+						} else {
+							key = std::string_view(left, ptr - left);
+						}
+						atts->emplace_back(key, val);
+						break;
+					} else {
+						ptr++;
+					}
+				}
+			} else {
+				break;
+			}
+		}
+		return ptr;
+	}
+	char const *find_tag_end(char const *p) const
+	{
+		return simd::find_tag_end(p, end_);
+	}
+	Attributes const &attributes_of(Tag const &tag) const
+	{
+		if (tag.lazy) {
+			char const *p = tag.raw_atts.data();
+			size_t capacity = tag.atts.capacity();
+			parse_attributes(p, p + tag.raw_atts.size(), &tag.atts);
+			tag.lazy = false;
+			if constexpr (Policy::stats) {
+				stats_.attributes += tag.atts.size();
+				stats_.allocations += tag.atts.capacity() != capacity;
+			}
+		}
+		return tag.atts;
+	}
+	std::string_view tag_name(size_t i) const
+	{
+		assert(i > 0 && i < stack_.size());
+		size_t left = stack_[i - 1].path_size + 1;
+		return std::string_view(path_.data() + left, stack_[i].path_size - left);
+	}
+	void push_tag(bool declaration = false)
+	{
+		if constexpr (!Policy::paths) {
+			stack_.push().content = ptr_;
+		} else {
+			Tag const &parent = stack_.back();
+			uint64_t hash;
+			if (declaration) {
+				decl_path_.assign(element_name_.data(), element_name_.size());
+				hash = fnv1a(FNV1A_BASIS, element_name_.data(), element_name_.size());
+			} else {
+				hash = fnv1a(fnv1a(parent.path_hash, "/", 1), element_name_.data(), element_name_.size());
+			}
+			int state = paths_ ? paths_->next(parent.path_state, element_name_) : 0;
+			size_t capacity = path_.capacity();
+			path_ += '/';
+			path_ += element_name_;
+			Tag &tag = stack_.push(); // the slot the attributes were parsed into
+			tag.content = ptr_;
+			tag.path_size = path_.size();
+			tag.path_hash = hash;
+			tag.path_state = state;
+			if constexpr (Policy::stats) {
+				stats_.allocations += path_.capacity() != capacity;
+			}
+		}
+		if constexpr (Policy::stats) {
+			stats_.max_depth = std::max(stats_.max_depth, (uint32_t)stack_.size());
+		}
+	}
+	void pop_tags(size_t depth)
+	{
+		stack_.resize(depth);
+		if constexpr (Policy::paths) {
+			path_.resize(stack_.back().path_size);
+		}
 	}
-	void pop_path()
+	// whether the end tag just read closes the element at stack_[i]
+	bool closes(size_t i) const
 	{
-		if (!last_path_.empty()) {
-			last_path_.clear();
-		} else if (!stack_.empty()) {
-			stack_.pop_back();
+		if constexpr (Policy::paths) {
+			return tag_name(i) == element_name_;
+		} else {
+			return true;
 		}
 	}
 	bool match_internal(char const *path) const
 	{
-		std::string currpath = current_path();
-		int n = currpath.size();
-		if (strncmp(path, currpath.c_str(), n) == 0) {
+		std::string const &current = current_path();
+		size_t n = current.size();
+		if (strncmp(path, current.data(), n) == 0) {
 			if (path[n] == 0) {
 				return true;
 			}
@@ -375,10 +1709,53 @@ private:
 		}
 		return false;
 	}
-	void append_chars(CharPart::Type type, char const *begin, char const *end)
+	void append_chars(typename CharPart::Type type, char const *begin, char const *end)
 	{
 		assert(!stack_.empty());
-		stack_.back().chars.append(type, begin, end);
+		if (!Policy::text || text_chunk_ > 0 || stack_.back().text_dropped) {
+			part_ = CharPart(type, begin, end);
+		} else {
+			std::vector<CharPart> const &parts = stack_.back().chars.chars_;
+			size_t capacity = parts.capacity();
+			stack_.back().chars.append(type, begin, end);
+			if constexpr (Policy::stats) {
+				stats_.allocations += parts.capacity() != capacity;
+				stats_.max_parts = std::max(stats_.max_parts, (uint32_t)parts.size());
+			}
+		}
+		if constexpr (Policy::stats) {
+			if (type == CharPart::CDATA) {
+				stats_.cdata_bytes += end - begin;
+			} else if (type == CharPart::Comment) {
+				stats_.comment_bytes += end - begin;
+			}
+		}
+	}
+	void count_text_entities() const
+	{
+		if constexpr (Policy::stats) {
+			for (CharPart const &part : encoded_chars().chars_) {
+				if (part.type() == CharPart::Text) {
+					count_entities(part.raw());
+				}
+			}
+		}
+	}
+	void count_entities(std::string_view const &s) const
+	{
+		// only references html_decode() replaces; a bare or malformed '&' is kept as text
+		char const *end = s.data() + s.size();
+		char const *p = simd::find(s.data(), end, '&');
+		while (p < end) {
+			uint32_t u;
+			if (char const *next = html_entity_(p, end, &u)) {
+				stats_.entities++;
+				p = next;
+			} else {
+				p++;
+			}
+			p = simd::find(p, end, '&');
+		}
 	}
 	bool is_element_name(std::string_view const &name) const
 	{
@@ -394,47 +1771,454 @@ private:
 		assert(!stack_.empty());
 		return stack_.back().chars;
 	}
+	bool in_buffer(std::string_view const &s) const
+	{
+		return s.data() >= buffer_.data() && s.data() < buffer_.data() + buffer_.size();
+	}
+	void pin(Tag &tag)
+	{
+		// copy what the tag refers to out of buffer_ before it is compacted; only views
+		// still in buffer_ are copied, and only chars parts added since the last pin can be
+		size_t blocks = tag.pinned.blocks() + tag.pinned_text.blocks();
+		auto move = [&](std::string_view &s, PinStore &store){
+			if (s.empty()) {
+				s = {};
+			} else if (in_buffer(s)) {
+				s = store.copy(s);
+			}
+		};
+		move(tag.raw_atts, tag.pinned);
+		for (auto &a : tag.atts) {
+			move(a.first, tag.pinned);
+			move(a.second, tag.pinned);
+		}
+		std::vector<CharPart> &parts = tag.chars.chars_;
+		for (size_t i = tag.pinned_parts; i < parts.size(); i++) {
+			tag.pinned_text_size += parts[i].sv_.size();
+		}
+		if (push_text_limit_ > 0 && tag.pinned_text_size > push_text_limit_) {
+			// e.g. the whitespace between the records under a root element: stop keeping it
+			tag.chars.clear();
+			tag.pinned_text.clear();
+			tag.pinned_text_size = 0;
+			tag.text_dropped = true;
+		}
+		for (size_t i = tag.pinned_parts; i < parts.size(); i++) {
+			move(parts[i].sv_, tag.pinned_text);
+		}
+		tag.pinned_parts = parts.size();
+		if constexpr (Policy::stats) {
+			stats_.allocations += tag.pinned.blocks() + tag.pinned_text.blocks() - blocks;
+		}
+	}
+	bool markup_complete_at(char const *at, size_t *scanned) const
+	{
+		// push mode: whether the markup starting at 'at' is entirely buffered;
+		// *scanned is how far past 'at' a terminator is known to be absent
+		size_t n = end_ - at;
+		auto prefix = [&](char const *s, size_t len){
+			return memcmp(at, s, n < len ? n : len) == 0;
+		};
+		auto scan = [&](size_t skip, char const *term){
+			if (n < skip) return false;
+			size_t from = *scanned > skip ? *scanned : skip;
+			char const *p = simd::find(at + from, end_, term, 3);
+			if (p == end_) {
+				*scanned = n - 2;
+				return false;
+			}
+			return true;
+		};
+		bool complete = false;
+		if (prefix("<![CDATA[", 9)) {
+			complete = scan(9, "]]>");
+		} else if (prefix("<!--", 4)) {
+			complete = scan(4, "-->");
+		} else {
+			complete = find_tag_end(at + 1) < end_;
+		}
+		if (complete) {
+			*scanned = 0;
+		}
+		return complete;
+	}
+	bool markup_complete()
+	{
+		return markup_complete_at(ptr_, &scanned_);
+	}
+	bool scan_subtree(char const **pp, size_t *depth, char const **lt, size_t *scanned) const
+	{
+		// jumps over markup from *pp until the end tag that closes *depth levels; on success
+		// *lt is its '<' and *pp is just after it. Otherwise *pp is at the first '<' whose
+		// markup is not buffered yet (push mode), or at end_.
+		char const *p = *pp;
+		auto after = [&](char const *q, size_t n){
+			return q < end_ ? q + n : end_;
+		};
+		bool found = false;
+		while (1) {
+			p = simd::find(p, end_, '<');
+			if (p == end_ || (!final_ && !markup_complete_at(p, scanned))) break;
+			char const *q = p + 1;
+			size_t n = end_ - q;
+			if (n >= 3 && memcmp(q, "!--", 3) == 0) {
+				p = after(simd::find(q + 3, end_, "-->", 3), 3);
+			} else if (n >= 8 && memcmp(q, "![CDATA[", 8) == 0) {
+				p = after(simd::find(q + 8, end_, "]]>", 3), 3);
+			} else if (n >= 1 && (*q == '?' || *q == '!')) {
+				p = after(find_tag_end(q), 1);
+			} else if (n >= 1 && *q == '/') {
+				char const *gt = find_tag_end(q);
+				if (--*depth == 0) {
+					*lt = p;
+					p = after(gt, 1);
+					found = true;
+					break;
+				}
+				p = after(gt, 1);
+			} else {
+				char const *gt = find_tag_end(q);
+				if (gt < end_ && gt[-1] != '/') {
+					++*depth;
+				}
+				p = after(gt, 1);
+			}
+		}
+		*pp = p;
+		return found;
+	}
+	bool find_close() const
+	{
+		// StartElement: finds the end tag of the element, cached for outer_xml(), inner_xml() and skip_element()
+		if (close_from_ == ptr_) return true;
+		char const *p = ptr_;
+		size_t depth = 1;
+		size_t scanned = 0;
+		char const *lt;
+		if (!scan_subtree(&p, &depth, &lt, &scanned)) return false;
+		close_from_ = ptr_;
+		close_lt_ = lt;
+		close_end_ = p;
+		return true;
+	}
+	// where to end a text chunk at limit without splitting a reference or a UTF-8 sequence
+	static char const *text_cut(char const *left, char const *limit)
+	{
+		char const *p = limit;
+		for (char const *q = limit; q > left && limit - q < 12;) { // "&#x0010FFFF;" is the longest reference
+			q--;
+			if (*q == ';') break;
+			if (*q == '&') {
+				p = q;
+				break;
+			}
+		}
+		for (int i = 0; i < 3 && p > left && (*p & 0xc0) == 0x80; i++) {
+			p--;
+		}
+		return p > left ? p : limit;
+	}
+	bool scan_cdata()
+	{
+		// inside a CDATA section, which is reported in pieces of text_chunk_ bytes if set
+		char const *left = ptr_;
+		char const *limit = end_;
+		if (text_chunk_ > 0 && size_t(end_ - left) > text_chunk_) {
+			limit = left + text_chunk_;
+		}
+		ptr_ = simd::find(left, limit, "]]>", 3);
+		if (ptr_ == limit && limit < end_) {
+			// "]]>" may start in the last two bytes; do not split a UTF-8 sequence either
+			ptr_ = limit - 2;
+			for (int i = 0; i < 3 && ptr_ > left + 1 && (*ptr_ & 0xc0) == 0x80; i++) {
+				ptr_--;
+			}
+		} else if (ptr_ == end_ && !final_) {
+			ptr_ = left;
+			chars_ = nullptr;
+			state_ = NeedMore;
+			return false;
+		} else {
+			cdata_ = false;
+		}
+		append_chars(CharPart::CDATA, left, ptr_);
+		if (!cdata_) {
+			ptr_ = ptr_ < end_ ? ptr_ + 3 : end_;
+		}
+		chars_ = nullptr;
+		state_ = Characters;
+		return true;
+	}
+	bool skip_scan()
+	{
+		// skip_element(): jump over markup until the end tag that closes skip_depth_ levels
+		chars_ = nullptr;
+		char const *lt;
+		if (close_from_ == ptr_ && skip_depth_ == 1) {
+			lt = close_lt_;
+			ptr_ = close_end_;
+			skip_depth_ = 0;
+		} else if (!scan_subtree(&ptr_, &skip_depth_, &lt, &scanned_)) {
+			state_ = final_ ? None : NeedMore;
+			if (final_) {
+				skip_depth_ = 0;
+			}
+			return false;
+		}
+		close_from_ = nullptr;
+		char const *p = lt + 2;
+		char const *left = p;
+		while (p < ptr_ && issym(*p)) {
+			p++;
+		}
+		element_name_ = std::string_view(left, p - left);
+		end_tag_ = lt;
+		state_ = EndElement;
+		return true;
+	}
 public:
-	Reader(char const *begin, char const *end)
+	BasicReader(char const *begin, char const *end)
 	{
 		init(begin, end);
 	}
 	
-	Reader(char const *ptr, size_t len)
+	BasicReader(char const *ptr, size_t len)
 	{
 		init(ptr, ptr + len);
 	}
 
-	Reader(std::string_view const &s)
+	BasicReader(std::string_view const &s)
 	{
 		begin_ = s.data();
 		end_ = s.data() + s.size();
 		init(begin_, end_);
 	}
+
+#ifndef XSTREAM_NO_MMAP
+	/**
+	 * @brief Opens a file and reads it through a memory mapping.
+	 *
+	 * Names, attribute values and text returned by the reader point straight
+	 * into the mapping, which stays alive as long as the reader (or a copy of
+	 * it) does.
+	 * @param flags combination of MappedFile::Flag
+	 * @return std::nullopt if the file cannot be opened or mapped
+	 */
+	static std::optional<BasicReader> open(char const *path, int flags = MappedFile::Sequential)
+	{
+		auto file = std::make_shared<MappedFile>();
+		if (!file->open(path, flags)) return std::nullopt;
+		BasicReader r(file->data(), file->size());
+		r.file_ = std::move(file);
+		return r;
+	}
+	static std::optional<BasicReader> open(std::string const &path, int flags = MappedFile::Sequential)
+	{
+		return open(path.c_str(), flags);
+	}
+#endif
+
+	/**
+	 * @brief Constructs a reader in push mode.
+	 *
+	 * Input is appended with feed() as it arrives and finish() marks the end
+	 * of the document. next() returns false with state() == NeedMore when the
+	 * buffered input holds no complete event. Only the unconsumed tail of the
+	 * input is kept, plus copies of the attributes of open elements and of
+	 * their text up to set_push_text_limit(). Views obtained from the reader
+	 * are invalidated by feed().
+	 */
+	BasicReader()
+	{
+		final_ = false;
+		init(nullptr, nullptr);
+	}
+
+	/**
+	 * @brief Points the reader at a new document.
+	 *
+	 * Everything allocated for earlier documents is kept for reuse, so a
+	 * reader that is reset for every message stops allocating once it has
+	 * seen the largest one. Path subscriptions stay in effect.
+	 */
+	void reset(char const *begin, char const *end)
+	{
+		final_ = true;
+#ifndef XSTREAM_NO_MMAP
+		file_.reset();
+#endif
+		init(begin, end);
+	}
+	void reset(char const *ptr, size_t len)
+	{
+		reset(ptr, ptr + len);
+	}
+	void reset(std::string_view const &s)
+	{
+		reset(s.data(), s.data() + s.size());
+	}
+	// back to push mode with an empty buffer
+	void reset()
+	{
+		reset(nullptr, nullptr);
+		final_ = false;
+	}
+	/**
+	 * @brief Reads the input as if the elements of path, such as "/root/items", were already open.
+	 *
+	 * For input that starts in the middle of a document. Call before the
+	 * first next(); path(), depth() and path subscriptions then see the
+	 * context elements as ancestors.
+	 */
+	void set_context(std::string_view path)
+	{
+		static_assert(Policy::paths, "set_context() needs ReaderPolicy::paths");
+		reset_stack();
+		while (!path.empty()) {
+			size_t n = path.find('/');
+			if (n != 0) {
+				stack_.spare();
+				element_name_ = path.substr(0, n);
+				push_tag();
+			}
+			path.remove_prefix(n == std::string_view::npos ? path.size() : n + 1);
+		}
+		element_name_ = {};
+	}
+	/**
+	 * @brief The offset in the input of the '<' that starts the current element.
+	 *
+	 * SIZE_MAX for context elements and for elements whose start is no
+	 * longer buffered in push mode.
+	 */
+	size_t element_offset() const
+	{
+		Tag const &tag = stack_.back();
+		return tag.start ? tag.start - begin_ : SIZE_MAX;
+	}
+	/**
+	 * @brief Counters accumulated since construction or reset_stats().
+	 *
+	 * Only kept when XSTREAM_STATS is defined (for every translation unit of
+	 * the program) or the policy sets stats; otherwise all zero, at no cost.
+	 * reset() does not clear them, so a reused reader accumulates across
+	 * documents. Stats can be summed with += across readers.
+	 */
+	Stats const &stats() const
+	{
+		return stats_;
+	}
+	void reset_stats()
+	{
+		stats_ = {};
+	}
+	/**
+	 * @brief The offset in the input just past the last event read.
+	 *
+	 * In push mode the offset is into the buffered input, which feed() compacts.
+	 */
+	size_t offset() const
+	{
+		return ptr_ - begin_;
+	}
+	void feed(char const *data, size_t len)
+	{
+		assert(!final_);
+		for (Tag &tag : stack_) {
+			pin(tag);
+			if (tag.start && in_buffer(std::string_view(tag.start, 1))) {
+				tag.start = nullptr;
+				tag.content = nullptr;
+			}
+		}
+		close_from_ = nullptr;
+		if (in_buffer(element_name_)) {
+			pinned_name_ = std::string(element_name_);
+			element_name_ = pinned_name_;
+		}
+		size_t pos = ptr_ - begin_;
+		size_t text = chars_ ? chars_ - begin_ : pos;
+		size_t keep = text < pos ? text : pos;
+		size_t capacity = buffer_.capacity();
+		buffer_.erase(buffer_.begin(), buffer_.begin() + keep);
+		buffer_.insert(buffer_.end(), data, data + len);
+		if constexpr (Policy::stats) {
+			stats_.allocations += buffer_.capacity() != capacity;
+		}
+		begin_ = buffer_.data();
+		end_ = begin_ + buffer_.size();
+		ptr_ = begin_ + (pos - keep);
+		if (chars_) {
+			chars_ = begin_ + (text - keep);
+		}
+	}
+	void feed(std::string_view const &s)
+	{
+		feed(s.data(), s.size());
+	}
+	void finish()
+	{
+		final_ = true;
+		scanned_ = 0;
+	}
+	bool need_more() const
+	{
+		return state_ == NeedMore;
+	}
 	int depth() const
 	{
 		return (int)stack_.size();
 	}
+	/**
+	 * @brief On an EndElement, the depth() once the end tag is consumed.
+	 *
+	 * depth() - 1 normally; less when the end tag also closes elements left
+	 * open inside the one it names, and depth() when it names no open element.
+	 */
+	int end_depth() const
+	{
+		size_t i = stack_.size() - 1;
+		if (i > 0 && closes(i)) return (int)i;
+		// unbalanced end tag: close up to the nearest element of that name
+		while (i > 1) {
+			i--;
+			if (closes(i)) return (int)i;
+		}
+		return (int)stack_.size();
+	}
 	struct D {
 		std::vector<int> depth_stack;
-		bool hold;
+		bool hold = false;
 	} d;
 	void hold()
 	{
+		static_assert(Policy::nesting, "hold() needs ReaderPolicy::nesting");
 		d.hold = true;
 	}
 	void nest()
 	{
+		static_assert(Policy::nesting, "nest() needs ReaderPolicy::nesting");
 		d.depth_stack.push_back(depth());
 	}
 
 	bool next()
 	{
-		if (d.hold) {
-			d.hold = false;
-			return true;
+		if constexpr (Policy::nesting) {
+			if (d.hold) {
+				d.hold = false;
+				return true;
+			}
+		}
+		char const *from = ptr_;
+		bool ok = _internal_next();
+		if constexpr (Policy::stats) {
+			stats_.bytes += ptr_ - from;
+			if (ok) {
+				stats_.events[state_]++;
+			}
 		}
-		if (_internal_next()) {
+		if (ok) {
+			if constexpr (!Policy::nesting) return true;
 			if (d.depth_stack.empty()) return true;
 			int e = depth();
 			if (state_ == EndElement && e > 0) {
@@ -444,66 +2228,126 @@ public:
 				return true;
 			}
 			d.depth_stack.pop_back();
-			hold();
+			d.hold = true;
+		}
+		return false;
+	}
+	/**
+	 * @brief Skips the content of the element just started.
+	 *
+	 * Call on a StartElement. The reader jumps to the element's end tag by
+	 * counting nesting depth with a fast scan, without producing events for
+	 * its descendants, and stops on its EndElement as next() would. The
+	 * element's text() is empty. Like next(), returns false at the end of
+	 * input, or with need_more() in push mode, where later next() calls
+	 * resume the skip. End tags must be balanced within the element.
+	 */
+	bool skip_element()
+	{
+		if (state_ != StartElement) return false;
+		d.hold = false;
+		if (!next_end_element_) {
+			skip_depth_ = 1;
+		}
+		return next();
+	}
+	/**
+	 * @brief The original bytes of the current element, from its start tag through its end tag.
+	 *
+	 * Available on a StartElement, where the end tag is found with the same
+	 * scan as skip_element() (which then reuses it), and on an EndElement.
+	 * Empty if the element is not entirely in the input, which in push mode
+	 * means in the buffered part of it.
+	 */
+	std::string_view outer_xml() const
+	{
+		Tag const &tag = stack_.back();
+		if (!tag.start) return {};
+		if (state_ == StartElement) {
+			if (next_end_element_) return std::string_view(tag.start, ptr_ - tag.start);
+			if (!find_close()) return {};
+			return std::string_view(tag.start, close_end_ - tag.start);
+		}
+		if (state_ == EndElement && stack_.size() > 1 && closes(stack_.size() - 1)) {
+			return std::string_view(tag.start, ptr_ - tag.start);
+		}
+		return {};
+	}
+	/**
+	 * @brief The original bytes between the current element's start and end tags; see outer_xml().
+	 */
+	std::string_view inner_xml() const
+	{
+		Tag const &tag = stack_.back();
+		if (!tag.content) return {};
+		if (state_ == StartElement) {
+			if (next_end_element_) return std::string_view(ptr_, 0);
+			if (!find_close()) return {};
+			return std::string_view(tag.content, close_lt_ - tag.content);
 		}
-		return false;
+		if (state_ == EndElement && stack_.size() > 1 && closes(stack_.size() - 1)) {
+			return std::string_view(tag.content, end_tag_ - tag.content);
+		}
+		return {};
 	}
 	bool _internal_next()
 	{
 		assert(!stack_.empty()); // least one element
 		if (state_ == EndElement) {
-			size_t i = stack_.size();
-			while (i > 1) {
-				i--;
-				size_t s = stack_[i].path.size();
-				size_t n = element_name_.size();
-				if (s > n) {
-					if (stack_[i].path[s - n - 1] == '/' && memcmp(&stack_[i].path[s - n], element_name_.data(), n) == 0) {
-						stack_.resize(i);
-						break;
-					}
-				}
+			size_t depth = end_depth();
+			if (depth < stack_.size()) {
+				pop_tags(depth);
 			}
 		} else if (state_ == Declaration) {
 			if (stack_.size() > 1) {
-				stack_.pop_back();
+				pop_tags(stack_.size() - 1);
 			} else {
 				reset_stack();
 			}
 		}
+		if (skip_depth_ > 0) {
+			return skip_scan();
+		}
 		while (1) {
 			if (!chars_) {
 				chars_ = ptr_;
 			}
 			if (next_end_element_) {
 				next_end_element_ = false;
+				end_tag_ = ptr_;
 				state_ = EndElement;
 				return true;
 			}
-			if (ptr_ + 9 < end_ && *ptr_ == '<') {
-				if (memcmp(ptr_, "<![CDATA[", 9) == 0) {
-					ptr_ += 9;
-					char const *left = ptr_;
-					while (ptr_ + 2 < end_ && memcmp(ptr_, "]]>", 3) != 0) {
-						ptr_++;
-					}
-					append_chars(CharPart::CDATA, left, ptr_);
-					ptr_ += 3;
-					chars_ = nullptr;
-					state_ = Characters;
-					return true;
-				}
+			if (cdata_) {
+				return scan_cdata();
+			}
+			bool cdata = ptr_ + 9 < end_ && *ptr_ == '<' && memcmp(ptr_, "<![CDATA[", 9) == 0;
+			if (!final_ && ptr_ < end_ && *ptr_ == '<' && !(cdata && text_chunk_ > 0) && !markup_complete()) {
+				chars_ = nullptr;
+				state_ = NeedMore;
+				return false;
+			}
+			if (cdata) {
+				ptr_ += 9;
+				cdata_ = true;
+				return scan_cdata();
 			}
 			if (ptr_ < end_ && *ptr_ == '<') {
-				ptr_++;
+				char const *lt = ptr_++;
 				if (ptr_ + 3 < end_ && memcmp(ptr_, "!--", 3) == 0) {
 					ptr_ += 3;
 					char const *left = ptr_;
-					while (ptr_ + 2 < end_ && memcmp(ptr_, "-->", 3) != 0) {
-						ptr_++;
+					ptr_ = simd::find(ptr_, end_, "-->", 3);
+					if constexpr (!Policy::comments) {
+						if constexpr (Policy::stats) {
+							stats_.comment_bytes += ptr_ - left;
+						}
+						ptr_ = ptr_ < end_ ? ptr_ + 3 : end_;
+						chars_ = nullptr;
+						continue;
 					}
 					append_chars(CharPart::Comment, left, ptr_);
-					ptr_ += 3;
+					ptr_ = ptr_ < end_ ? ptr_ + 3 : end_;
 					chars_ = nullptr;
 					state_ = Comment;
 					return true;
@@ -524,60 +2368,33 @@ public:
 						ptr_++;
 					}
 					element_name_ = std::string_view(left, ptr_ - left);
-					std::vector<std::pair<std::string_view, std::string_view>> atts;
-					while (ptr_ < end_ && isspace((unsigned char)*ptr_)) {
-						ptr_++;
+					size_t slots = stack_.capacity();
+					Tag &tag = stack_.spare();
+					tag.start = lt;
+					if constexpr (Policy::stats) {
+						stats_.allocations += stack_.capacity() != slots;
+					}
+					if (start == '/') {
 						while (ptr_ < end_ && isspace((unsigned char)*ptr_)) {
 							ptr_++;
 						}
-						char const *eq = nullptr;
-						char quote = 0;
-						if (start != '/' && ptr_ < end_ && issymf(*ptr_)) {
-							char const *left = ptr_++;
-							ptr_++;
-							while (ptr_ < end_) {
-								if (!eq) {
-									if (*ptr_ == '=') {
-										eq = ptr_;
-										ptr_++;
-										if (ptr_ < end_) {
-											char q = *ptr_;
-											if (q == '\'' || q == '\"') {
-												quote = q;
-												ptr_++;
-											}
-										}
-									} else if (isspace(*ptr_) || *ptr_ == '>' || *ptr_ == '/') {
-										break;
-									} else {
-										ptr_++;
-									}
-								} else if (quote != 0 ? (*ptr_ == quote) : (isspace((unsigned char)*ptr_) || *ptr_ == '>' || *ptr_ == '/')) {
-									if (*ptr_ == quote) {
-										ptr_++;
-									}
-									std::string_view key;
-									std::string_view val;
-									if (eq) {
-										key = std::string_view(left, eq - left);
-										char const *left = eq + 1;
-										char const *right = ptr_;
-										if (left + 1 < right && left[0] == quote && right[-1] == quote) {
-											left++;
-											right--;
-										}
-										val = std::string_view(left, right - left);
-									} else {
-										key = std::string_view(left, ptr_ - left);
-									}
-									atts.emplace_back(key, val);
-									break;
-								} else {
-									ptr_++;
-								}
-							}
-						} else {
-							break;
+					} else if (!Policy::attributes || lazy_attributes_) {
+						char const *gt = find_tag_end(ptr_);
+						char const *stop = gt;
+						if (gt < end_ && stop > ptr_ && (stop[-1] == '/' || (start == '?' && stop[-1] == '?'))) {
+							stop--;
+						}
+						if constexpr (Policy::attributes) {
+							tag.raw_atts = std::string_view(ptr_, stop - ptr_);
+							tag.lazy = true;
+						}
+						ptr_ = stop;
+					} else {
+						size_t capacity = tag.atts.capacity();
+						ptr_ = parse_attributes(ptr_, end_, &tag.atts);
+						if constexpr (Policy::stats) {
+							stats_.attributes += tag.atts.size();
+							stats_.allocations += tag.atts.capacity() != capacity;
 						}
 					}
 					if (ptr_ < end_ && *ptr_ == '/') {
@@ -588,8 +2405,8 @@ public:
 						ptr_++;
 						if (ptr_ < end_ && *ptr_ == '>') {
 							ptr_++;
-							stack_.push_back(std::string(element_name_));
-							stack_.back().atts = std::move(atts);
+							push_tag(true);
+							chars_ = nullptr;
 							state_ = Declaration;
 							return true;
 						}
@@ -598,10 +2415,10 @@ public:
 						ptr_++;
 						chars_ = nullptr;
 						if (start == '/') {
+							end_tag_ = lt;
 							state_ = EndElement;
 						} else {
-							stack_.push_back(current_path() + '/' + std::string(element_name_));
-							stack_.back().atts = std::move(atts);
+							push_tag();
 							state_ = StartElement;
 						}
 						return true;
@@ -610,28 +2427,38 @@ public:
 				state_ = Error;
 				return true;
 			} else if (ptr_ < end_) {
-				if (state_ == EndElement) {
-					last_path_ = {};
+				char const *left = ptr_;
+				char const *limit = end_;
+				if (text_chunk_ > 0 && size_t(end_ - left) > text_chunk_) {
+					limit = left + text_chunk_;
 				}
-				while (1) {
-					int c = -1;
-					if (ptr_ < end_) {
-						c = (unsigned char)*ptr_;
-					}
-					if (c == -1) {
-						state_ = None;
-						return false;
-					}
-					if (c == '<') {
-						append_chars(CharPart::Text, chars_, ptr_);
+				ptr_ = simd::find(ptr_ + scanned_, limit, '<');
+				scanned_ = 0;
+				if (ptr_ == limit && limit < end_) {
+					ptr_ = text_cut(left, limit);
+					append_chars(CharPart::Text, chars_, ptr_);
+					chars_ = nullptr;
+					state_ = Characters;
+					return true;
+				}
+				if (ptr_ == end_) {
+					if (!final_) {
+						scanned_ = end_ - left;
+						ptr_ = left;
 						chars_ = nullptr;
-						state_ = Characters;
-						return true;
+						state_ = NeedMore;
+						return false;
 					}
-					ptr_++;
+					state_ = None;
+					return false;
 				}
+				append_chars(CharPart::Text, chars_, ptr_);
+				chars_ = nullptr;
+				state_ = Characters;
+				return true;
 			} else {
-				state_ = None;
+				chars_ = nullptr;
+				state_ = final_ ? None : NeedMore;
 				return false;
 			}
 		}
@@ -674,20 +2501,121 @@ public:
 	}
 	std::string const &path() const
 	{
+		static_assert(Policy::paths, "path() needs ReaderPolicy::paths");
 		return current_path();
 	}
 	bool match_start(char const *path) const
 	{
+		static_assert(Policy::paths, "match_start() needs ReaderPolicy::paths");
 		return is_start_element() && match_internal(path);
 	}
 	bool match_end(char const *path) const
 	{
+		static_assert(Policy::paths, "match_end() needs ReaderPolicy::paths");
 		return is_end_element() && match_internal(path);
 	}
+	bool match(StaticPath const &path) const
+	{
+		static_assert(Policy::paths, "match() needs ReaderPolicy::paths");
+		Tag const &tag = stack_.back();
+		std::string const &current = current_path();
+		return tag.path_hash == path.hash() && current.size() == path.size() && memcmp(current.data(), path.data(), path.size()) == 0;
+	}
+	bool match_start(StaticPath const &path) const
+	{
+		return is_start_element() && match(path);
+	}
+	bool match_end(StaticPath const &path) const
+	{
+		return is_end_element() && match(path);
+	}
+
+	/**
+	 * @brief Subscribes to a compiled set of path patterns.
+	 *
+	 * After this, matches() lists the ids of the patterns that match path().
+	 * The set must outlive the reader; nullptr unsubscribes.
+	 */
+	void set_paths(PathSet const *paths)
+	{
+		static_assert(Policy::paths, "set_paths() needs ReaderPolicy::paths");
+		paths_ = paths;
+		for (size_t i = 1; i < stack_.size(); i++) {
+			stack_[i].path_state = paths_ ? paths_->next(stack_[i - 1].path_state, tag_name(i)) : 0;
+		}
+	}
+	PathSet const *paths() const
+	{
+		static_assert(Policy::paths, "paths() needs ReaderPolicy::paths");
+		return paths_;
+	}
+
+	/**
+	 * @brief Reports character data in Characters events of at most n bytes, without keeping it.
+	 *
+	 * For documents with very large text nodes. Text and CDATA sections are
+	 * cut into pieces of at most n bytes (n is raised to 16), at points that
+	 * split neither a reference nor a UTF-8 sequence; read each with
+	 * characters(). Nothing is accumulated on the element, so text() is
+	 * empty, and in push mode no more than n bytes of pending text are
+	 * buffered. Memory use no longer depends on the size of a text node.
+	 * 0, the default, turns this off.
+	 */
+	void set_text_chunk_size(size_t n)
+	{
+		text_chunk_ = n == 0 ? 0 : std::max(n, (size_t)16);
+	}
+	/**
+	 * @brief Bounds the text push mode keeps for one open element, 1 MiB by default.
+	 *
+	 * An element whose text grows past n bytes, such as a root element
+	 * collecting the whitespace between millions of records, stops keeping
+	 * it: what was kept is released, text() is empty from then on, and
+	 * characters() still reports each piece as it is read, as with
+	 * set_text_chunk_size(). 0 keeps all text. Pull mode is not affected.
+	 */
+	void set_push_text_limit(size_t n)
+	{
+		push_text_limit_ = n;
+	}
+	/**
+	 * @brief Defers attribute tokenizing until attributes are asked for.
+	 *
+	 * Start tags are skipped with a quote-aware scan for '>' and only the raw
+	 * attribute span is recorded; attribute() and attributes() tokenize it on
+	 * first use. This pays off when most elements' attributes are never read.
+	 */
+	void set_lazy_attributes(bool lazy)
+	{
+		static_assert(Policy::attributes, "set_lazy_attributes() needs ReaderPolicy::attributes");
+		lazy_attributes_ = lazy;
+	}
+	PathSet::Matches matches() const
+	{
+		static_assert(Policy::paths, "matches() needs ReaderPolicy::paths");
+		if (!paths_) return {};
+		return paths_->matches(stack_.back().path_state);
+	}
+	bool match(int id) const
+	{
+		return matches().contains(id);
+	}
+	bool match_start(int id) const
+	{
+		return is_start_element() && match(id);
+	}
+	bool match_end(int id) const
+	{
+		return is_end_element() && match(id);
+	}
 	std::string name() const
 	{
 		return std::string(element_name_);
 	}
+	std::string_view name_view() const
+	{
+		return element_name_;
+	}
 	bool is_name(char const *s) const
 	{
 		size_t n = element_name_.size();
@@ -698,18 +2626,98 @@ public:
 	}
 	std::string text() const
 	{
+		static_assert(Policy::text, "text() needs ReaderPolicy::text");
+		count_text_entities();
 		return encoded_chars().to_string();
 	}
+	/**
+	 * @brief Decodes text() into out, reusing its capacity instead of returning a new string.
+	 */
+	void text_into(std::string &out) const
+	{
+		static_assert(Policy::text, "text_into() needs ReaderPolicy::text");
+		count_text_entities();
+		encoded_chars().to_string(&out);
+	}
+	/**
+	 * @brief text() as a view into the input, without decoding or copying.
+	 *
+	 * Available when the text is a single run of character data without
+	 * references, or a single CDATA section; std::nullopt when it has to be
+	 * decoded or joined. The view is valid as long as the input, and in
+	 * push mode until the next feed().
+	 */
+	std::optional<std::string_view> text_view() const
+	{
+		static_assert(Policy::text, "text_view() needs ReaderPolicy::text");
+		return encoded_chars().view();
+	}
+	/**
+	 * @brief Decodes text() as base64 and appends the bytes to out, skipping whitespace.
+	 *
+	 * The digits are decoded straight from the input, or from the pieces of
+	 * for_each_text_chunk(), without building text(). out is a container of
+	 * bytes with resize() and data(), such as std::string or std::vector<char>.
+	 * @return false, with out unchanged, if the text is not base64
+	 */
+	template <typename Container> bool read_base64(Container &out) const
+	{
+		static_assert(Policy::text, "read_base64() needs ReaderPolicy::text");
+		static_assert(sizeof(*out.data()) == 1, "read_base64() needs a container of bytes");
+		size_t len = 0;
+		for (CharPart const &part : encoded_chars().chars_) {
+			len += part.raw().size();
+		}
+		size_t size = out.size();
+		out.resize(size + Base64Decoder::max_decoded_size(len));
+		char *p = (char *)out.data() + size;
+		Base64Decoder decoder;
+		for_each_text_chunk([&](std::string_view s){
+			if (p) {
+				p = decoder.decode(s, p);
+			}
+		});
+		if (p) {
+			p = decoder.finish(p);
+		}
+		out.resize(p ? p - (char *)out.data() : size);
+		return p != nullptr;
+	}
+	/**
+	 * @brief Calls fn(std::string_view) with the decoded text() in consecutive pieces, without building it.
+	 *
+	 * The pieces are runs of the input between references, the decoded
+	 * references, and CDATA sections; they are only valid during the call.
+	 */
+	template <typename F> void for_each_text_chunk(F fn) const
+	{
+		static_assert(Policy::text, "for_each_text_chunk() needs ReaderPolicy::text");
+		count_text_entities();
+		encoded_chars().for_each_chunk(fn);
+	}
 	CharPart characters() const
 	{
 		assert(!stack_.empty());
+		if (!Policy::text || text_chunk_ > 0 || stack_.back().text_dropped) return part_;
 		if (stack_.back().chars.chars_.empty()) return {};
 		return stack_.back().chars.chars_.back();
 	}
+	/**
+	 * @brief Calls fn(name, value) for each attribute of the current element, without copying.
+	 */
+	template <typename F> void for_each_attribute(F fn) const
+	{
+		static_assert(Policy::attributes, "for_each_attribute() needs ReaderPolicy::attributes");
+		assert(!stack_.empty());
+		for (auto const &attr : attributes_of(stack_.back())) {
+			fn(attr.first, EscapedAttributeValue(attr.second));
+		}
+	}
 	std::optional<EscapedAttributeValue> attribute(std::string_view const &name) const
 	{
+		static_assert(Policy::attributes, "attribute() needs ReaderPolicy::attributes");
 		assert(!stack_.empty());
-		for (auto const &attr : stack_.back().atts) {
+		for (auto const &attr : attributes_of(stack_.back())) {
 			if (attr.first == name) {
 				return attr.second;
 			}
@@ -719,109 +2727,430 @@ public:
 	std::string attribute(std::string_view const &name, std::string const &defval) const
 	{
 		auto s = attribute(name);
+		if constexpr (Policy::stats) {
+			if (s) {
+				count_entities(s->raw());
+			}
+		}
 		return s ? (std::string)*s : defval;
 	}
 	std::vector<std::pair<std::string, EscapedAttributeValue>> attributes() const
 	{
+		static_assert(Policy::attributes, "attributes() needs ReaderPolicy::attributes");
 		std::vector<std::pair<std::string, EscapedAttributeValue>> ret;
 		assert(!stack_.empty());
-		for (auto const &attr : stack_.back().atts) {
+		for (auto const &attr : attributes_of(stack_.back())) {
 			ret.emplace_back(std::string(attr.first), attr.second);
 		}
 		return ret;
 	}
-}; // class Reader
+}; // class BasicReader
+
+typedef BasicReader<ReaderPolicy> Reader;
+
+// sinks for BasicWriter; write(p, n) receives each flushed block
+
+/**
+ * @brief Passes output to a function, as the original Writer did.
+ */
+class FunctionSink {
+private:
+	std::function<int (char const *p, int n)> fn_;
+public:
+	template <typename F, typename = std::enable_if_t<std::is_invocable_v<F &, char const *, size_t>>> FunctionSink(F fn)
+		: fn_(std::move(fn))
+	{
+	}
+	void write(char const *p, size_t n)
+	{
+		fn_(p, (int)n);
+	}
+};
+
+/**
+ * @brief Appends output to a std::string.
+ */
+class StringSink {
+private:
+	std::string *out_;
+public:
+	StringSink(std::string *out)
+		: out_(out)
+	{
+	}
+	void write(char const *p, size_t n)
+	{
+		out_->append(p, n);
+	}
+};
+
+/**
+ * @brief Appends output to a std::vector<char>.
+ */
+class VectorSink {
+private:
+	std::vector<char> *out_;
+public:
+	VectorSink(std::vector<char> *out)
+		: out_(out)
+	{
+	}
+	void write(char const *p, size_t n)
+	{
+		out_->insert(out_->end(), p, p + n);
+	}
+};
+
+/**
+ * @brief Writes output to a file descriptor.
+ *
+ * Retries partial writes; after an error, further output is discarded and failed() returns true.
+ */
+class FdSink {
+private:
+	int fd_;
+	bool failed_ = false;
+public:
+	FdSink(int fd)
+		: fd_(fd)
+	{
+	}
+	void write(char const *p, size_t n)
+	{
+		while (n > 0 && !failed_) {
+#ifdef _WIN32
+			int r = ::_write(fd_, p, (unsigned int)std::min(n, (size_t)0x40000000));
+#else
+			ssize_t r = ::write(fd_, p, n);
+			if (r < 0 && errno == EINTR) continue;
+#endif
+			if (r <= 0) {
+				failed_ = true;
+				break;
+			}
+			p += r;
+			n -= r;
+		}
+	}
+	bool failed() const
+	{
+		return failed_;
+	}
+};
+
+/**
+ * @brief Writes output to a FILE stream.
+ */
+class FileSink {
+private:
+	FILE *fp_;
+	bool failed_ = false;
+public:
+	FileSink(FILE *fp)
+		: fp_(fp)
+	{
+	}
+	void write(char const *p, size_t n)
+	{
+		if (!failed_ && fwrite(p, 1, n, fp_) != n) {
+			failed_ = true;
+		}
+	}
+	bool failed() const
+	{
+		return failed_;
+	}
+};
 
-class Writer {
+/**
+ * @brief XML generator writing to a Sink.
+ *
+ * Output is collected in a buffer of buffer_size bytes and passed to
+ * sink.write(p, n) only when the buffer is full, on flush(), on
+ * end_document() and on destruction.
+ */
+template <typename Sink> class BasicWriter {
+public:
+	/**
+	 * @brief An element name interned with tag(); only valid for the writer that made it.
+	 */
+	class Tag {
+		friend class BasicWriter;
+	private:
+		int id_ = -1;
+		Tag(int id)
+			: id_(id)
+		{
+		}
+	public:
+		Tag() = default;
+		bool operator == (Tag const &t) const
+		{
+			return id_ == t.id_;
+		}
+		bool operator != (Tag const &t) const
+		{
+			return id_ != t.id_;
+		}
+	};
 private:
-	std::function<int (char const *p, int n)> fn_writer;
-	std::vector<char> line_;
+	struct TagBytes {
+		size_t offset; // of "<name</name>" in tags_
+		size_t size; // of the name
+	};
+	struct Open {
+		int tag; // -1 for a name given as a string
+		size_t offset; // of its "</name>" in names_
+	};
+	Sink sink_;
+	std::unique_ptr<char[]> buffer_;
+	size_t capacity_;
+	size_t size_ = 0;
 	bool inside_tag_ = false;
 	size_t newline_ = false;
 	int indent_step_ = 4;
-	std::vector<std::string> element_stack_;
+	bool compact_ = false;
+	std::vector<Open> element_stack_;
+	std::string names_; // "</name>" of each open element without a tag, in nesting order
+	std::string tags_; // "<name" and "</name>" of each tag, back to back
+	std::vector<TagBytes> tag_bytes_;
+	void write_line(char const *p, size_t n)
+	{
+		if (n > capacity_ - size_) {
+			flush();
+			if (n > capacity_) {
+				sink_.write(p, n);
+				return;
+			}
+		}
+		memcpy(buffer_.get() + size_, p, n);
+		size_ += n;
+	}
 	void write_line(std::string_view const &s)
 	{
-		line_.insert(line_.end(), s.begin(), s.end());
+		write_line(s.data(), s.size());
+	}
+	void write_line(char c)
+	{
+		if (size_ == capacity_) {
+			flush();
+			if (capacity_ == 0) {
+				sink_.write(&c, 1);
+				return;
+			}
+		}
+		buffer_[size_++] = c;
 	}
 	void write_indent(size_t n)
 	{
-		n *= indent_step_;
+		static char const spaces[] = "                                                                ";
+		if (compact_) return;
 		if (newline_) {
-			n++;
+			write_line('\n');
 		}
-		line_.insert(line_.begin(), n, ' ');
-		if (newline_) {
-			line_[0] = '\n';
+		n *= indent_step_;
+		while (n > 0) {
+			size_t len = std::min(n, sizeof(spaces) - 1);
+			write_line(spaces, len);
+			n -= len;
 		}
 	}
-	void flush()
+	template <typename T> using if_number = std::enable_if_t<std::is_arithmetic_v<T> && !std::is_same_v<T, char> && !std::is_same_v<T, signed char> && !std::is_same_v<T, unsigned char>>;
+	template <typename T> void write_number(T v)
 	{
-		if (!line_.empty()) {
-			fn_writer(line_.data(), line_.size());
-			line_.clear();
+		if constexpr (std::is_same_v<T, bool>) {
+			write_line(v ? std::string_view("true") : std::string_view("false"));
+		} else if (std::is_floating_point_v<T> && !std::isfinite(v)) {
+			// the xs:double spellings; to_chars would write "nan" and "inf"
+			write_line(std::isnan(v) ? std::string_view("NaN") : v < 0 ? std::string_view("-INF") : std::string_view("INF"));
+		} else {
+			size_t const max = 64; // longer than any integer or shortest round-trip float
+			if (capacity_ - size_ < max) {
+				flush();
+				if (capacity_ < max) {
+					char tmp[max];
+					auto r = std::to_chars(tmp, tmp + max, v);
+					write_line(tmp, r.ptr - tmp);
+					return;
+				}
+			}
+			char *p = buffer_.get() + size_;
+			auto r = std::to_chars(p, p + max, v);
+			size_ += r.ptr - p;
 		}
 	}
+	void write_encoded(std::string_view const &s)
+	{
+		html_encode_runs_(s.data(), s.data() + s.size(), true, [this](char const *p, size_t n){
+			write_line(p, n);
+		});
+	}
 	void close_tag()
 	{
 		if (inside_tag_) {
-			write_line(">");
+			write_line('>');
 			inside_tag_ = false;
 		}
 	}
+	void take(BasicWriter &w)
+	{
+		buffer_ = std::move(w.buffer_);
+		capacity_ = std::exchange(w.capacity_, 0);
+		size_ = std::exchange(w.size_, 0);
+		inside_tag_ = std::exchange(w.inside_tag_, false);
+		newline_ = std::exchange(w.newline_, false);
+		indent_step_ = w.indent_step_;
+		compact_ = w.compact_;
+		element_stack_ = std::move(w.element_stack_);
+		names_ = std::move(w.names_);
+		tags_ = std::move(w.tags_);
+		tag_bytes_ = std::move(w.tag_bytes_);
+		w.element_stack_.clear();
+		w.names_.clear();
+		w.tags_.clear();
+		w.tag_bytes_.clear();
+	}
 public:
-	Writer(std::function<int (char const *p, int n)> fn_writer)
-		: fn_writer(fn_writer)
+	BasicWriter(Sink sink, size_t buffer_size = 65536)
+		: sink_(std::move(sink))
+		, buffer_(new char[buffer_size])
+		, capacity_(buffer_size)
+	{
+	}
+	// not copyable, as both copies would write the buffered output; a moved-from writer may only be destroyed or assigned to
+	BasicWriter(BasicWriter const &) = delete;
+	BasicWriter &operator = (BasicWriter const &) = delete;
+	BasicWriter(BasicWriter &&w)
+		: sink_(std::move(w.sink_))
+	{
+		take(w);
+	}
+	BasicWriter &operator = (BasicWriter &&w)
 	{
+		if (this != &w) {
+			flush();
+			sink_ = std::move(w.sink_);
+			take(w);
+		}
+		return *this;
+	}
+	~BasicWriter()
+	{
+		flush();
+	}
+	Sink &sink()
+	{
+		return sink_;
+	}
+	/**
+	 * @brief Sets the number of spaces per nesting level (4 by default).
+	 */
+	void set_indent(int step)
+	{
+		indent_step_ = step < 0 ? 0 : step;
+	}
+	/**
+	 * @brief Emits no newlines or indentation, and writes empty elements as <name/>.
+	 */
+	void set_compact(bool compact)
+	{
+		compact_ = compact;
+	}
+	/**
+	 * @brief Passes the buffered output to the sink.
+	 */
+	void flush()
+	{
+		if (size_ > 0) {
+			sink_.write(buffer_.get(), size_);
+			size_ = 0;
+		}
 	}
 	void start_document()
 	{
-		std::string s = R"---(<?xml version="1.0" encoding="UTF-8"?>)---" "\n";
-		write_line(s);
+		write_line(R"---(<?xml version="1.0" encoding="UTF-8"?>)---");
+		if (!compact_) {
+			write_line('\n');
+		}
 	}
 	void end_document()
 	{
 		while (!element_stack_.empty()) {
 			end_element();
 		}
-		if (newline_) {
-			char c = '\n';
-			fn_writer(&c, 1);
+		if (newline_ && !compact_) {
+			write_line('\n');
+		}
+		flush();
+	}
+	/**
+	 * @brief Interns an element name.
+	 *
+	 * Starting and ending an element by its Tag copies prebuilt bytes
+	 * instead of the name. Interning the same name again returns the same Tag.
+	 */
+	Tag tag(std::string_view const &name)
+	{
+		for (size_t i = 0; i < tag_bytes_.size(); i++) {
+			TagBytes const &t = tag_bytes_[i];
+			if (std::string_view(tags_.data() + t.offset + 1, t.size) == name) {
+				return Tag((int)i);
+			}
 		}
+		tag_bytes_.push_back({tags_.size(), name.size()});
+		tags_ += '<';
+		tags_ += name;
+		tags_ += "</";
+		tags_ += name;
+		tags_ += '>';
+		return Tag((int)tag_bytes_.size() - 1);
 	}
-	void start_element(std::string const &name)
+	void start_element(std::string_view const &name)
 	{
 		close_tag();
-		flush();
 		write_indent(element_stack_.size());
-		element_stack_.push_back(name);
-		write_line("<");
+		element_stack_.push_back({-1, names_.size()});
+		names_ += "</";
+		names_ += name;
+		names_ += '>';
+		write_line('<');
 		write_line(name);
 		inside_tag_ = true;
 		newline_ = true;
 	}
+	void start_element(Tag tag)
+	{
+		assert(tag.id_ >= 0 && tag.id_ < (int)tag_bytes_.size());
+		TagBytes const &t = tag_bytes_[tag.id_];
+		close_tag();
+		write_indent(element_stack_.size());
+		element_stack_.push_back({tag.id_, 0});
+		write_line(tags_.data() + t.offset, t.size + 1);
+		inside_tag_ = true;
+		newline_ = true;
+	}
 	void end_element()
 	{
 		if (!element_stack_.empty()) {
-			std::string name = element_stack_.back();
+			Open const &e = element_stack_.back();
 			if (inside_tag_) {
-				write_line(" />");
-				if (!element_stack_.empty()) {
-					element_stack_.pop_back();
-				}
+				write_line(compact_ ? "/>" : " />");
 				inside_tag_ = false;
 			} else {
-				close_tag();
-				flush();
-				element_stack_.pop_back();
 				if (newline_) {
-					write_indent(element_stack_.size());
+					write_indent(element_stack_.size() - 1);
+				}
+				if (e.tag < 0) {
+					write_line(names_.data() + e.offset, names_.size() - e.offset);
+				} else {
+					TagBytes const &t = tag_bytes_[e.tag];
+					write_line(tags_.data() + t.offset + t.size + 1, t.size + 3);
 				}
-				write_line("</");
-				write_line(name);
-				write_line(">");
 			}
-			flush();
+			if (e.tag < 0) {
+				names_.resize(e.offset);
+			}
+			element_stack_.pop_back();
 			newline_ = true;
 		}
 	}
@@ -829,19 +3158,91 @@ public:
 	{
 		close_tag();
 		newline_ = false;
-		write_line(html_encode(s));
+		write_encoded(s);
+	}
+	/**
+	 * @brief Writes an integer, a float (shortest round-trip form) or a bool as text.
+	 */
+	template <typename T, typename = if_number<T>> void write_characters(T value)
+	{
+		close_tag();
+		newline_ = false;
+		write_number(value);
+	}
+	/**
+	 * @brief Writes data[0..len) as base64 text, encoded straight into the output buffer.
+	 */
+	void write_base64(void const *data, size_t len)
+	{
+		close_tag();
+		newline_ = false;
+		char const *p = (char const *)data;
+		while (len > 0) {
+			if (capacity_ - size_ < 4) {
+				flush();
+				if (capacity_ < 4) {
+					char tmp[4];
+					size_t n = std::min(len, (size_t)3);
+					write_line(tmp, base64_encode_to(p, n, tmp) - tmp);
+					p += n;
+					len -= n;
+					continue;
+				}
+			}
+			size_t n = std::min(len, (capacity_ - size_) / 4 * 3);
+			char *out = buffer_.get() + size_;
+			size_ += base64_encode_to(p, n, out) - out;
+			p += n;
+			len -= n;
+		}
+	}
+	void write_base64(std::string_view const &data)
+	{
+		write_base64(data.data(), data.size());
+	}
+	/**
+	 * @brief Writes text the caller guarantees is already escaped, or markup to insert as is.
+	 */
+	void write_raw(std::string_view const &s)
+	{
+		close_tag();
+		newline_ = false;
+		write_line(s);
 	}
 	void write_attribute(std::string_view const &name, std::string_view const &value)
 	{
 		if (inside_tag_) {
-			write_line(" ");
+			write_line(' ');
+			write_line(name);
+			write_line("=\"");
+			write_encoded(value);
+			write_line('"');
+		}
+	}
+	template <typename T, typename = if_number<T>> void write_attribute(std::string_view const &name, T value)
+	{
+		if (inside_tag_) {
+			write_line(' ');
+			write_line(name);
+			write_line("=\"");
+			write_number(value);
+			write_line('"');
+		}
+	}
+	/**
+	 * @brief Writes an attribute whose value the caller guarantees is already escaped.
+	 */
+	void write_attribute_raw(std::string_view const &name, std::string_view const &value)
+	{
+		if (inside_tag_) {
+			write_line(' ');
 			write_line(name);
 			write_line("=\"");
-			write_line(html_encode(value));
-			write_line("\"");
+			write_line(value);
+			write_line('"');
 		}
 	}
-	void element(std::string const &name, std::function<void ()> fn)
+	void element(std::string_view const &name, std::function<void ()> fn)
 	{
 		start_element(name);
 		if (fn) {
@@ -849,13 +3250,29 @@ public:
 		}
 		end_element();
 	}
-	void text_element(std::string const &name, std::string const &text)
+	void element(Tag tag, std::function<void ()> fn)
 	{
-		element(name, [&](){
-			write_characters(text);
-		});
+		start_element(tag);
+		if (fn) {
+			fn();
+		}
+		end_element();
 	}
-}; // class Writer
+	void text_element(std::string_view const &name, std::string_view const &text)
+	{
+		start_element(name);
+		write_characters(text);
+		end_element();
+	}
+	void text_element(Tag tag, std::string_view const &text)
+	{
+		start_element(tag);
+		write_characters(text);
+		end_element();
+	}
+}; // class BasicWriter
+
+typedef BasicWriter<FunctionSink> Writer;
 
 } // namespace xstream
 #endif // XSTREAM_H
@@ -0,0 +1,313 @@
+// Xstream - Header-only Streaming pull-based XML/HTML Parser and Generator
+// Copyright (C) 2025 S.Fuchita (soramimi)
+// This software is distributed under the MIT license.
+
+#ifndef XSTREAM_DOM_H
+#define XSTREAM_DOM_H
+
+#include "xstream.h"
+
+namespace xstream {
+
+/**
+ * @brief A read-only document tree stored as a flat tape of nodes.
+ *
+ * Nodes are kept in document order in one array and attributes in another;
+ * names, attribute values and text are offsets into the source, which must
+ * outlive the document. A node's descendants follow it directly on the tape
+ * and end at Node::end, so the first child of i is i + 1 and the next
+ * sibling is node(i).end. Node 0 is the document itself.
+ */
+class Document {
+public:
+	enum Kind : uint8_t {
+		Root,
+		Element,
+		Text,
+		CDATA,
+		Comment,
+		Declaration,
+	};
+	static constexpr uint32_t npos = UINT32_MAX;
+	struct Span {
+		uint32_t offset = 0;
+		uint32_t size = 0;
+	};
+	struct Node {
+		Kind kind = Root;
+		uint32_t parent = npos;
+		uint32_t end = 0; // one past the last descendant
+		Span name; // elements and declarations
+		Span value; // raw text of text, CDATA and comment nodes
+		uint32_t atts = 0; // first attribute
+		uint32_t atts_size = 0;
+	};
+	struct Attribute {
+		Span name;
+		Span value; // escaped, as in the source
+	};
+private:
+	std::string_view source_;
+	std::vector<Node> nodes_;
+	std::vector<Attribute> atts_;
+	Span span(std::string_view const &s) const
+	{
+		return {uint32_t(s.data() - source_.data()), uint32_t(s.size())};
+	}
+	std::string_view view(Span const &s) const
+	{
+		return source_.substr(s.offset, s.size);
+	}
+	// characters() then returns just the current event's data, empty for an empty section
+	struct Events : ReaderPolicy {
+		static constexpr bool text = false;
+	};
+	bool build()
+	{
+		// every node but the root starts at a '<' or follows a '>', so this bounds the tape
+		size_t lt = 0;
+		size_t eq = 0;
+		char const *end = source_.data() + source_.size();
+		for (char const *p = source_.data(); (p = simd::find(p, end, '<')) < end; p++) {
+			lt++;
+		}
+		for (char const *p = source_.data(); (p = simd::find(p, end, '=')) < end; p++) {
+			eq++;
+		}
+		nodes_.reserve(2 * lt + 2);
+		atts_.reserve(eq);
+
+		nodes_.emplace_back();
+		uint32_t cur = 0;
+		auto add = [&](Kind kind){
+			uint32_t i = (uint32_t)nodes_.size();
+			nodes_.emplace_back();
+			Node &node = nodes_.back();
+			node.kind = kind;
+			node.parent = cur;
+			node.end = i + 1;
+			return i;
+		};
+		auto add_atts = [&](auto const &r, Node &node){
+			node.atts = (uint32_t)atts_.size();
+			r.for_each_attribute([&](std::string_view const &name, auto const &value){
+				atts_.push_back({span(name), span(value.raw())});
+			});
+			node.atts_size = (uint32_t)atts_.size() - node.atts;
+		};
+		auto close = [&](uint32_t i){
+			nodes_[i].end = (uint32_t)nodes_.size();
+		};
+
+		BasicReader<Events> r(source_);
+		using Part = decltype(r.characters());
+		while (r.next()) {
+			switch (r.state()) {
+			case Reader::StartElement:
+				{
+					uint32_t i = add(Element);
+					nodes_[i].name = span(r.name_view());
+					add_atts(r, nodes_[i]);
+					cur = i;
+				}
+				break;
+			case Reader::EndElement:
+				// an unbalanced end tag closes up to the nearest open element of its name, as the reader does
+				for (uint32_t i = cur; i != 0; i = nodes_[i].parent) {
+					if (r.is_end_element(view(nodes_[i].name))) {
+						for (uint32_t j = cur; j != nodes_[i].parent; j = nodes_[j].parent) {
+							close(j);
+						}
+						cur = nodes_[i].parent;
+						break;
+					}
+				}
+				break;
+			case Reader::Characters:
+			case Reader::Comment:
+				{
+					auto part = r.characters();
+					std::string_view raw = part.raw();
+					if (raw.empty()) break;
+					Kind kind = r.state() == Reader::Comment ? Comment : part.type() == Part::CDATA ? CDATA : Text;
+					uint32_t i = add(kind);
+					nodes_[i].value = span(raw);
+				}
+				break;
+			case Reader::Declaration:
+				{
+					uint32_t i = add(Declaration);
+					nodes_[i].name = span(r.name_view());
+					add_atts(r, nodes_[i]);
+				}
+				break;
+			default:
+				return false;
+			}
+		}
+		if (r.state() == Reader::Error) return false;
+		for (uint32_t j = cur; j != npos; j = nodes_[j].parent) {
+			close(j);
+		}
+		return true;
+	}
+public:
+	/**
+	 * @brief Reads source once and builds its tape.
+	 *
+	 * source must outlive the document. Unclosed elements end with the input.
+	 * @return std::nullopt if the reader reports an error or source is 4 GiB or more
+	 */
+	static std::optional<Document> parse(std::string_view const &source)
+	{
+		if (source.size() >= npos) return std::nullopt;
+		Document doc;
+		doc.source_ = source;
+		if (!doc.build()) return std::nullopt;
+		return doc;
+	}
+	std::string_view source() const
+	{
+		return source_;
+	}
+	size_t size() const
+	{
+		return nodes_.size();
+	}
+	Node const &node(uint32_t i) const
+	{
+		return nodes_[i];
+	}
+	Kind kind(uint32_t i) const
+	{
+		return nodes_[i].kind;
+	}
+	std::string_view name(uint32_t i) const
+	{
+		return view(nodes_[i].name);
+	}
+	/**
+	 * @brief The raw bytes of a text, CDATA or comment node, with references not decoded.
+	 */
+	std::string_view value(uint32_t i) const
+	{
+		return view(nodes_[i].value);
+	}
+	uint32_t parent(uint32_t i) const
+	{
+		return nodes_[i].parent;
+	}
+	uint32_t first_child(uint32_t i) const
+	{
+		return i + 1 < nodes_[i].end ? i + 1 : npos;
+	}
+	uint32_t next_sibling(uint32_t i) const
+	{
+		uint32_t p = nodes_[i].parent;
+		if (p == npos) return npos;
+		uint32_t j = nodes_[i].end;
+		return j < nodes_[p].end ? j : npos;
+	}
+	uint32_t first_element(uint32_t i) const
+	{
+		uint32_t c = first_child(i);
+		while (c != npos && nodes_[c].kind != Element) {
+			c = next_sibling(c);
+		}
+		return c;
+	}
+	uint32_t next_element(uint32_t i) const
+	{
+		uint32_t c = next_sibling(i);
+		while (c != npos && nodes_[c].kind != Element) {
+			c = next_sibling(c);
+		}
+		return c;
+	}
+	/**
+	 * @brief The first child element of i named name, or npos.
+	 */
+	uint32_t child(uint32_t i, std::string_view const &name) const
+	{
+		for (uint32_t c = first_element(i); c != npos; c = next_element(c)) {
+			if (view(nodes_[c].name) == name) return c;
+		}
+		return npos;
+	}
+	/**
+	 * @brief The first element at a path such as "/root/item", or npos.
+	 *
+	 * Relative paths start at from; each step takes the first child of that name.
+	 */
+	uint32_t find(std::string_view path, uint32_t from = 0) const
+	{
+		uint32_t i = path.size() > 0 && path[0] == '/' ? 0 : from;
+		while (i != npos && !path.empty()) {
+			if (path[0] == '/') {
+				path.remove_prefix(1);
+				continue;
+			}
+			size_t n = path.find('/');
+			i = child(i, path.substr(0, n));
+			path.remove_prefix(n == std::string_view::npos ? path.size() : n);
+		}
+		return i;
+	}
+	uint32_t document_element() const
+	{
+		return first_element(0);
+	}
+	std::pair<Attribute const *, Attribute const *> attributes(uint32_t i) const
+	{
+		Attribute const *a = atts_.data() + nodes_[i].atts;
+		return {a, a + nodes_[i].atts_size};
+	}
+	std::string_view attribute_name(Attribute const &a) const
+	{
+		return view(a.name);
+	}
+	Reader::EscapedAttributeValue attribute_value(Attribute const &a) const
+	{
+		return Reader::EscapedAttributeValue(view(a.value));
+	}
+	std::optional<Reader::EscapedAttributeValue> attribute(uint32_t i, std::string_view const &name) const
+	{
+		auto range = attributes(i);
+		for (Attribute const *a = range.first; a < range.second; a++) {
+			if (view(a->name) == name) return attribute_value(*a);
+		}
+		return std::nullopt;
+	}
+	std::string attribute(uint32_t i, std::string_view const &name, std::string const &defval) const
+	{
+		auto s = attribute(i, name);
+		return s ? s->to_string() : defval;
+	}
+	/**
+	 * @brief The decoded text and CDATA directly inside i, as Reader::text() returns at its end.
+	 */
+	std::string text(uint32_t i) const
+	{
+		size_t len = 0;
+		for (uint32_t c = first_child(i); c != npos; c = next_sibling(c)) {
+			if (nodes_[c].kind == Text || nodes_[c].kind == CDATA) {
+				len += nodes_[c].value.size;
+			}
+		}
+		std::string s(len, 0);
+		char *p = &s[0];
+		for (uint32_t c = first_child(i); c != npos; c = next_sibling(c)) {
+			std::string_view v = view(nodes_[c].value);
+			if (nodes_[c].kind == Text) {
+				p = html_decode_to(v.data(), v.data() + v.size(), p);
+			} else if (nodes_[c].kind == CDATA) {
+				p = std::copy(v.begin(), v.end(), p);
+			}
+		}
+		s.resize(p - s.data());
+		return s;
+	}
+}; // class Document
+
+} // namespace xstream
+#endif // XSTREAM_DOM_H
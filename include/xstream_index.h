@@ -0,0 +1,258 @@
+// Xstream - Header-only Streaming pull-based XML/HTML Parser and Generator
+// Copyright (C) 2025 S.Fuchita (soramimi)
+// This software is distributed under the MIT license.
+
+#ifndef XSTREAM_INDEX_H
+#define XSTREAM_INDEX_H
+
+#include "xstream.h"
+
+namespace xstream {
+
+/**
+ * @brief Byte offsets of selected elements of a document, for reading them later without a full parse.
+ *
+ * build() reads the document once and records every element matching a
+ * PathSet: where it starts and ends, its depth, the id of the first
+ * matching pattern, the path of its parent and, optionally, the value of a
+ * key attribute. save() and load() store the index in a binary sidecar file
+ * (native byte order), and reader() starts a Reader on one element with its
+ * ancestors as context.
+ */
+class Index {
+public:
+	struct Entry {
+		uint64_t begin = 0; // the '<' of the start tag
+		uint64_t end = 0; // just past the end tag
+		uint32_t depth = 0; // Reader::depth() of the element
+		uint32_t pattern = 0; // first matching pattern of the PathSet
+		uint32_t parent = 0; // index of the parent's path in contexts
+		uint32_t key = 0; // offset of the key in keys_
+		uint32_t key_size = 0;
+		uint32_t reserved = 0;
+	};
+	static constexpr size_t npos = SIZE_MAX;
+private:
+	static constexpr uint32_t MAGIC = 0x58495358; // "XSIX"
+	static constexpr uint32_t VERSION = 1;
+	struct Header {
+		uint32_t magic = MAGIC;
+		uint32_t version = VERSION;
+		uint64_t source_size = 0;
+		uint64_t entries = 0;
+		uint64_t order = 0;
+		uint64_t contexts = 0; // bytes, NUL-separated
+		uint64_t keys = 0; // bytes
+	};
+	uint64_t source_size_ = 0;
+	std::vector<Entry> entries_;
+	std::vector<uint32_t> order_; // entries with a key, sorted by key
+	std::vector<std::string> contexts_;
+	std::string keys_;
+	std::string_view key_of(Entry const &e) const
+	{
+		return std::string_view(keys_).substr(e.key, e.key_size);
+	}
+	void sort_keys()
+	{
+		order_.clear();
+		for (uint32_t i = 0; i < entries_.size(); i++) {
+			if (entries_[i].key_size > 0) {
+				order_.push_back(i);
+			}
+		}
+		std::stable_sort(order_.begin(), order_.end(), [&](uint32_t a, uint32_t b){
+			return key_of(entries_[a]) < key_of(entries_[b]);
+		});
+	}
+public:
+	/**
+	 * @brief Reads a document with r and indexes the elements matching paths.
+	 *
+	 * r must be positioned at the start of the input, e.g. as returned by
+	 * Reader::open(), and is read to the end. The PathSet r subscribes to is
+	 * restored afterwards.
+	 * @param key_attribute if not empty, the attribute whose decoded value find() looks up
+	 */
+	static Index build(Reader &r, PathSet const &paths, std::string_view const &key_attribute = {})
+	{
+		Index index;
+		std::map<std::string, uint32_t, std::less<>> contexts;
+		std::vector<uint32_t> open; // entries whose end tag is pending
+		std::string key;
+		PathSet const *saved = r.paths();
+		r.set_paths(&paths);
+		while (r.next()) {
+			if (r.is_end_element()) {
+				// an unbalanced end tag may close several levels at once
+				while (!open.empty() && index.entries_[open.back()].depth > (uint32_t)r.end_depth()) {
+					index.entries_[open.back()].end = r.offset();
+					open.pop_back();
+				}
+			}
+			if (!r.is_start_element() || r.matches().empty()) continue;
+			Entry e;
+			e.begin = r.element_offset();
+			e.end = e.begin;
+			e.depth = (uint32_t)r.depth();
+			e.pattern = (uint32_t)*r.matches().begin();
+			std::string const &path = r.path();
+			std::string_view parent(path.data(), path.rfind('/'));
+			auto it = contexts.find(parent);
+			if (it == contexts.end()) {
+				it = contexts.emplace(std::string(parent), (uint32_t)index.contexts_.size()).first;
+				index.contexts_.emplace_back(parent);
+			}
+			e.parent = it->second;
+			if (!key_attribute.empty()) {
+				if (auto v = r.attribute(key_attribute)) {
+					key.resize(v->size());
+					key.resize(v->decode_to(&key[0]) - key.data());
+					e.key = (uint32_t)index.keys_.size();
+					e.key_size = (uint32_t)key.size();
+					index.keys_ += key;
+				}
+			}
+			open.push_back((uint32_t)index.entries_.size());
+			index.entries_.push_back(e);
+		}
+		index.source_size_ = r.offset();
+		for (uint32_t i : open) {
+			index.entries_[i].end = index.source_size_; // unclosed elements end with the input
+		}
+		r.set_paths(saved);
+		index.sort_keys();
+		return index;
+	}
+	static Index build(std::string_view const &source, PathSet const &paths, std::string_view const &key_attribute = {})
+	{
+		Reader r(source);
+		return build(r, paths, key_attribute);
+	}
+	bool save(char const *path) const
+	{
+		Header h;
+		h.source_size = source_size_;
+		h.entries = entries_.size();
+		h.order = order_.size();
+		std::string contexts;
+		for (std::string const &s : contexts_) {
+			contexts += s;
+			contexts += '\0';
+		}
+		h.contexts = contexts.size();
+		h.keys = keys_.size();
+		FILE *fp = fopen(path, "wb");
+		if (!fp) return false;
+		bool ok = fwrite(&h, sizeof(h), 1, fp) == 1;
+		ok = ok && fwrite(entries_.data(), sizeof(Entry), entries_.size(), fp) == entries_.size();
+		ok = ok && fwrite(order_.data(), sizeof(uint32_t), order_.size(), fp) == order_.size();
+		ok = ok && fwrite(contexts.data(), 1, contexts.size(), fp) == contexts.size();
+		ok = ok && fwrite(keys_.data(), 1, keys_.size(), fp) == keys_.size();
+		ok = fclose(fp) == 0 && ok;
+		return ok;
+	}
+	bool save(std::string const &path) const
+	{
+		return save(path.c_str());
+	}
+	/**
+	 * @return std::nullopt if the file cannot be read or is not an index of this version
+	 */
+	static std::optional<Index> load(char const *path)
+	{
+		FILE *fp = fopen(path, "rb");
+		if (!fp) return std::nullopt;
+		Index index;
+		Header h;
+		std::string contexts;
+		bool ok = fread(&h, sizeof(h), 1, fp) == 1 && h.magic == MAGIC && h.version == VERSION && h.order <= h.entries;
+		if (ok) {
+			// refuse sizes larger than the file before allocating for them
+			long here = ftell(fp);
+			ok = fseek(fp, 0, SEEK_END) == 0;
+			uint64_t rest = ok ? (uint64_t)(ftell(fp) - here) : 0;
+			ok = ok && fseek(fp, here, SEEK_SET) == 0;
+			ok = ok && h.entries <= rest / sizeof(Entry) && h.contexts <= rest && h.keys <= rest;
+			ok = ok && h.entries * sizeof(Entry) + h.order * sizeof(uint32_t) + h.contexts + h.keys == rest;
+		}
+		if (ok) {
+			index.source_size_ = h.source_size;
+			index.entries_.resize(h.entries);
+			index.order_.resize(h.order);
+			contexts.resize(h.contexts);
+			index.keys_.resize(h.keys);
+			ok = fread(index.entries_.data(), sizeof(Entry), h.entries, fp) == h.entries;
+			ok = ok && fread(index.order_.data(), sizeof(uint32_t), h.order, fp) == h.order;
+			ok = ok && fread(&contexts[0], 1, h.contexts, fp) == h.contexts;
+			ok = ok && fread(&index.keys_[0], 1, h.keys, fp) == h.keys;
+		}
+		fclose(fp);
+		if (!ok) return std::nullopt;
+		for (size_t i = 0; i < contexts.size();) {
+			size_t n = contexts.find('\0', i);
+			if (n == std::string::npos) return std::nullopt;
+			index.contexts_.push_back(contexts.substr(i, n - i));
+			i = n + 1;
+		}
+		for (Entry const &e : index.entries_) {
+			if (e.parent >= index.contexts_.size() || (uint64_t)e.key + e.key_size > index.keys_.size() || e.begin > e.end || e.end > h.source_size) return std::nullopt;
+		}
+		for (uint32_t i : index.order_) {
+			if (i >= index.entries_.size()) return std::nullopt;
+		}
+		return index;
+	}
+	static std::optional<Index> load(std::string const &path)
+	{
+		return load(path.c_str());
+	}
+	size_t size() const
+	{
+		return entries_.size();
+	}
+	Entry const &entry(size_t i) const
+	{
+		return entries_[i];
+	}
+	uint64_t source_size() const
+	{
+		return source_size_;
+	}
+	std::string const &parent_path(size_t i) const
+	{
+		return contexts_[entries_[i].parent];
+	}
+	std::string_view key(size_t i) const
+	{
+		return key_of(entries_[i]);
+	}
+	/**
+	 * @brief The first entry, in document order, whose key is key; npos if none.
+	 */
+	size_t find(std::string_view const &key) const
+	{
+		auto it = std::lower_bound(order_.begin(), order_.end(), key, [&](uint32_t i, std::string_view const &k){
+			return key_of(entries_[i]) < k;
+		});
+		if (it == order_.end() || key_of(entries_[*it]) != key) return npos;
+		return *it;
+	}
+	/**
+	 * @brief A reader over entry i of source, with the element's ancestors as context.
+	 *
+	 * source is the indexed document, typically a MappedFile of it.
+	 * @return std::nullopt if source does not have the size of the indexed document
+	 */
+	std::optional<Reader> reader(std::string_view const &source, size_t i) const
+	{
+		if (source.size() != source_size_ || i >= entries_.size()) return std::nullopt;
+		Entry const &e = entries_[i];
+		Reader r(source.data() + e.begin, source.data() + e.end);
+		r.set_context(contexts_[e.parent]);
+		return r;
+	}
+}; // class Index
+
+} // namespace xstream
+#endif // XSTREAM_INDEX_H
@@ -0,0 +1,194 @@
+// Xstream - Header-only Streaming pull-based XML/HTML Parser and Generator
+// Copyright (C) 2025 S.Fuchita (soramimi)
+// This software is distributed under the MIT license.
+
+#ifndef XSTREAM_PARALLEL_H
+#define XSTREAM_PARALLEL_H
+
+#include "xstream.h"
+#include <atomic>
+#include <thread>
+
+namespace xstream {
+
+struct ParallelOptions {
+	unsigned threads = 0; // 0 for std::thread::hardware_concurrency()
+	size_t min_chunk = 1 << 20; // smallest span of records handed to one reader
+	PathSet const *paths = nullptr; // subscribed by every reader
+	bool lazy_attributes = false;
+};
+
+static inline unsigned parallel_threads(ParallelOptions const &options = {})
+{
+	unsigned n = options.threads ? options.threads : std::thread::hardware_concurrency();
+	return n ? n : 1;
+}
+
+// calls fn(index, thread) for each index in [0, count) on up to threads threads
+template <typename F> static inline void run_parallel_(size_t count, unsigned threads, F fn)
+{
+	std::atomic<size_t> next{0};
+	auto worker = [&](unsigned thread){
+		for (size_t i; (i = next++) < count;) {
+			fn(i, thread);
+		}
+	};
+	if (threads > count) {
+		threads = (unsigned)count;
+	}
+	std::vector<std::thread> pool;
+	for (unsigned t = 1; t < threads; t++) {
+		pool.emplace_back(worker, t);
+	}
+	worker(0);
+	for (std::thread &t : pool) {
+		t.join();
+	}
+}
+
+// jumps over markup from p, tracking nesting in *depth, and returns the first
+// markup '<' at or after stop (or end); markup that straddles stop is passed whole
+static inline char const *scan_markup_(char const *p, char const *stop, char const *end, long *depth)
+{
+	auto after = [&](char const *q, size_t n){
+		return q < end ? q + n : end;
+	};
+	while (1) {
+		p = simd::find(p, end, '<');
+		if (p >= stop) return p;
+		char const *q = p + 1;
+		size_t n = end - q;
+		if (n >= 3 && memcmp(q, "!--", 3) == 0) {
+			p = after(simd::find(q + 3, end, "-->", 3), 3);
+		} else if (n >= 8 && memcmp(q, "![CDATA[", 8) == 0) {
+			p = after(simd::find(q + 8, end, "]]>", 3), 3);
+		} else if (n >= 1 && (*q == '?' || *q == '!')) {
+			p = after(simd::find_tag_end(q, end), 1);
+		} else if (n >= 1 && *q == '/') {
+			--*depth;
+			p = after(simd::find_tag_end(q, end), 1);
+		} else {
+			char const *gt = simd::find_tag_end(q, end);
+			if (gt < end && gt[-1] != '/') {
+				++*depth;
+			}
+			p = after(gt, 1);
+		}
+	}
+}
+
+/**
+ * @brief Reads the children of the root element ("records") on several threads.
+ *
+ * The content of the root element is cut into chunks at boundaries between
+ * records. Candidate cuts are the next start tag with the first record's
+ * name after evenly spaced offsets; each chunk is then checked in parallel
+ * with a depth-counting scan that passes over comments, CDATA and quoted
+ * values, and a cut that turns out not to be between records is dropped.
+ * Each chunk is read by its own Reader, whose context is the root element,
+ * so paths are those of the whole document.
+ *
+ * fn(Reader &r, unsigned thread) is called on the StartElement of every
+ * record. It may read up to the record's EndElement; the rest of the record
+ * is skipped. thread is below parallel_threads(options), for per-thread
+ * sinks. Records are delivered in document order within a chunk, but
+ * chunks run concurrently, and fn must not throw.
+ * @return The number of records, or 0 if source has no root element.
+ */
+template <typename F> static inline size_t parse_parallel(std::string_view const &source, F fn, ParallelOptions const &options = {})
+{
+	char const *begin = source.data();
+	char const *end = begin + source.size();
+
+	// the root element and the name of the first record
+	std::string root;
+	std::string record;
+	char const *first = nullptr;
+	{
+		Reader r(source);
+		while (r.next() && !r.is_start_element()) {
+		}
+		if (!r.is_start_element()) return 0;
+		root = r.path();
+		first = begin + r.offset();
+		while (r.next()) {
+			if (r.is_start_element()) {
+				if (r.depth() == 3) {
+					record = r.name();
+				}
+				break;
+			}
+			if (r.is_end_element()) break;
+		}
+	}
+
+	unsigned threads = parallel_threads(options);
+	size_t chunks = threads == 1 ? 1 : std::min<size_t>(threads * 4, std::max<size_t>((end - first) / std::max<size_t>(options.min_chunk, 1), 1));
+	std::vector<char const *> cuts{first};
+	if (!record.empty()) {
+		std::string needle = "<" + record;
+		for (size_t i = 1; i < chunks; i++) {
+			size_t pos = (first - begin) + (end - first) * i / chunks;
+			while ((pos = source.find(needle, std::max(pos, size_t(cuts.back() - begin) + 1))) != std::string_view::npos) {
+				char c = pos + needle.size() < source.size() ? source[pos + needle.size()] : 0;
+				if (isspace((unsigned char)c) || c == '>' || c == '/') break;
+				pos++;
+			}
+			if (pos == std::string_view::npos) break;
+			cuts.push_back(begin + pos);
+		}
+	}
+	cuts.push_back(end);
+
+	// check every chunk but the last from depth 0, then keep the cuts reached at depth 0
+	struct Scan {
+		char const *stop;
+		long depth;
+	};
+	std::vector<Scan> scans(cuts.size() - 1);
+	run_parallel_(scans.size() - 1, threads, [&](size_t i, unsigned){
+		scans[i].depth = 0;
+		scans[i].stop = scan_markup_(cuts[i], cuts[i + 1], end, &scans[i].depth);
+	});
+	std::vector<char const *> bounds{cuts[0]};
+	if (cuts.size() > 2) {
+		Scan s = scans[0];
+		for (size_t i = 1; i + 1 < cuts.size(); i++) {
+			if (s.stop == cuts[i] && s.depth == 0) {
+				bounds.push_back(cuts[i]);
+				s = scans[i];
+			} else if (i + 1 < cuts.size() - 1) {
+				s.stop = scan_markup_(s.stop, cuts[i + 1], end, &s.depth);
+			}
+		}
+	}
+	bounds.push_back(end);
+
+	std::atomic<size_t> total{0};
+	std::vector<Reader> readers(std::min<size_t>(threads, bounds.size() - 1));
+	run_parallel_(bounds.size() - 1, threads, [&](size_t i, unsigned thread){
+		Reader &r = readers[thread];
+		r.reset(bounds[i], bounds[i + 1]);
+		r.set_paths(options.paths);
+		r.set_lazy_attributes(options.lazy_attributes);
+		r.set_context(root);
+		int const depth = r.depth() + 1;
+		size_t n = 0;
+		while (r.next()) {
+			if (r.is_start_element() && r.depth() == depth) {
+				fn(r, thread);
+				n++;
+				if (r.is_start_element() && r.depth() == depth) {
+					r.skip_element();
+				}
+				while (!(r.is_end_element() && r.depth() == depth) && r.next()) {
+				}
+			}
+		}
+		total += n;
+	});
+	return total;
+}
+
+} // namespace xstream
+#endif // XSTREAM_PARALLEL_H
@@ -1,22 +1,10 @@
-
 #include "xstream.h"
 
-#ifdef _WIN32	
-#include <fcntl.h>
-#include <io.h>
-#include <sys/stat.h>
-#include <sys/types.h>
-#else
-#include <fcntl.h>
-#include <sys/stat.h>
-#include <sys/types.h>
-#include <unistd.h>
-#endif
-
 void test1()
 {
 #if 1
 	std::string xml = R"---(<hoge><fuga foo='bar'>Hello, <![CDATA[world]]></fuga></hoge>)---";
+	xstream::Reader x(xml);
 #else
 	
 #ifdef _WIN32	
@@ -24,22 +12,11 @@ void test1()
 #else
 	char const *path = "/tmp/test.xml";
 #endif
-	std::vector<char> data;
-	int fd = open(path, O_RDONLY);
-	if (fd != -1) {
-		struct stat st;
-		if (fstat(fd, &st) == 0) {
-			data.resize(st.st_size);
-			read(fd, data.data(), data.size());
-		}
-	}
-	if (data.empty()) return 1;
-
-	std::string_view xml(data.data(), data.size());
-
+	auto file = xstream::Reader::open(path);
+	if (!file) return;
+	xstream::Reader &x = *file;
 #endif
 
-	xstream::Reader x(xml);
 	while (x.next()) {
 		if (x.is_characters()) {
 			auto v = x.characters().decode();
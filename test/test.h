@@ -3,4 +3,10 @@
 
 #include <xstream.h>
 
+// a reader that keeps stats() counters without XSTREAM_STATS
+struct StatsPolicy : xstream::ReaderPolicy {
+	static constexpr bool stats = true;
+};
+typedef xstream::BasicReader<StatsPolicy> StatsReader;
+
 #endif // TEST_H
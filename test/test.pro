@@ -17,8 +17,19 @@ win32:CONFIG(release,debug|release):LIBS += -LC:/googletest-1.16.0/build/lib/Rel
 
 HEADERS += \
 	test.h \
-	../include/xstream.h
+	../include/xstream.h \
+	../include/xstream_dom.h \
+	../include/xstream_parallel.h \
+	../include/xstream_index.h
 SOURCES += \
     test1.cpp \
     test2.cpp \
+    test3.cpp \
+    test4.cpp \
+    test5.cpp \
+    test6.cpp \
+    test7.cpp \
+    test8.cpp \
+    test9.cpp \
+    test10.cpp \
     testmain.cpp
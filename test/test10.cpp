@@ -0,0 +1,149 @@
+
+#include "test.h"
+#include <gtest/gtest.h>
+
+using namespace xstream;
+
+namespace {
+
+std::string reference_base64(std::string_view s)
+{
+	static char const digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	std::string out;
+	for (size_t i = 0; i < s.size(); i += 3) {
+		uint32_t v = (unsigned char)s[i] << 16;
+		if (i + 1 < s.size()) v |= (unsigned char)s[i + 1] << 8;
+		if (i + 2 < s.size()) v |= (unsigned char)s[i + 2];
+		out += digits[v >> 18];
+		out += digits[(v >> 12) & 0x3f];
+		out += i + 1 < s.size() ? digits[(v >> 6) & 0x3f] : '=';
+		out += i + 2 < s.size() ? digits[v & 0x3f] : '=';
+	}
+	return out;
+}
+
+std::string encode(std::string_view s)
+{
+	std::string out(base64_encoded_size(s.size()), 0);
+	out.resize(base64_encode_to(s.data(), s.size(), &out[0]) - out.data());
+	return out;
+}
+
+std::optional<std::string> decode(std::string_view s, size_t piece = std::string::npos)
+{
+	std::string out(Base64Decoder::max_decoded_size(s.size()), 0);
+	Base64Decoder decoder;
+	char *p = &out[0];
+	for (size_t i = 0; p && i < s.size(); i += piece) {
+		p = decoder.decode(s.substr(i, piece), p);
+	}
+	if (p) {
+		p = decoder.finish(p);
+	}
+	if (!p) return std::nullopt;
+	out.resize(p - out.data());
+	return out;
+}
+
+} // namespace
+
+// base64 の各実装が1バイトずつの処理と一致するかテスト
+TEST(Base64, AllLevels)
+{
+	unsigned int seed = 1;
+	std::string bytes;
+	for (int i = 0; i < 5000; i++) {
+		seed = seed * 1103515245 + 12345;
+		bytes += (char)(seed >> 16);
+	}
+
+	simd::Level saved = simd::level();
+	for (simd::Level level : {simd::Scalar, simd::SSE2, simd::AVX2}) {
+		simd::set_level(level);
+		for (size_t len = 0; len < 100; len++) {
+			std::string_view s(bytes.data() + len, len);
+			std::string b64 = encode(s);
+			ASSERT_EQ(b64, reference_base64(s));
+			EXPECT_EQ(decode(b64), std::string(s));
+		}
+		std::string b64 = encode(bytes);
+		ASSERT_EQ(b64, reference_base64(bytes));
+		EXPECT_EQ(decode(b64), bytes);
+
+		// 改行で区切られた入力と、任意の位置で分割した入力
+		std::string lines;
+		for (size_t i = 0; i < b64.size(); i += 76) {
+			lines += b64.substr(i, 76) + "\r\n";
+		}
+		EXPECT_EQ(decode(lines), bytes);
+		EXPECT_EQ(decode("  " + b64.substr(0, 101) + " \t" + b64.substr(101)), bytes);
+		for (size_t piece : {1, 7, 33, 100}) {
+			EXPECT_EQ(decode(lines, piece), bytes);
+		}
+
+		// 不正な入力
+		EXPECT_FALSE(decode(b64.substr(0, 1000) + "*" + b64.substr(1000)));
+		EXPECT_FALSE(decode(b64 + "A"));
+		EXPECT_FALSE(decode("QQ=A"));
+		EXPECT_FALSE(decode("QQ="));
+		EXPECT_FALSE(decode("Q==="));
+		EXPECT_EQ(decode("QQ=="), "A");
+		EXPECT_EQ(decode("QUI="), "AB");
+		EXPECT_EQ(decode("QUI"), "AB"); // 省略されたパディング
+		EXPECT_EQ(decode(" QQ = = "), "A");
+	}
+	simd::set_level(saved);
+}
+
+// 要素の内容を base64 で書き出して読み込むテスト
+TEST(Base64, ReaderWriter)
+{
+	std::string blob;
+	for (int i = 0; i < 3000; i++) {
+		blob += (char)(i * 7 + (i >> 5));
+	}
+
+	for (size_t buffer_size : {(size_t)65536, (size_t)10, (size_t)3}) {
+		std::string xml;
+		{
+			BasicWriter<StringSink> w(&xml, buffer_size);
+			w.start_element("blobs");
+			w.start_element("blob");
+			w.write_base64(blob.data(), blob.size());
+			w.end_element();
+			w.start_element("empty");
+			w.write_base64(std::string_view());
+			w.end_element();
+			w.end_element();
+		}
+		EXPECT_NE(xml.find(reference_base64(blob)), std::string::npos);
+
+		Reader r(xml);
+		std::vector<char> data;
+		std::string empty = "keep";
+		while (r.next()) {
+			if (r.is_end_element("blob")) {
+				EXPECT_TRUE(r.read_base64(data));
+			} else if (r.is_end_element("empty")) {
+				EXPECT_TRUE(r.read_base64(empty));
+			}
+		}
+		EXPECT_EQ(std::string(data.data(), data.size()), blob);
+		EXPECT_EQ(empty, "keep");
+	}
+
+	// 文字参照・CDATA・コメントを含む内容と、不正な内容
+	std::string xml = "<r><a>QUJD&#10;REVG<!-- x --><![CDATA[R0g=]]></a><b>QUJD!</b></r>";
+	Reader r(xml);
+	std::string a = ">";
+	std::string b = "unchanged";
+	while (r.next()) {
+		if (r.is_end_element("a")) {
+			EXPECT_TRUE(r.read_base64(a));
+		} else if (r.is_end_element("b")) {
+			EXPECT_FALSE(r.read_base64(b));
+		}
+	}
+	EXPECT_EQ(a, ">ABCDEFGH");
+	EXPECT_EQ(b, "unchanged");
+}
@@ -166,8 +166,15 @@ TEST(XML, ProcessingInstructions)
 
     xstream::Reader r(xml);
     int itemCount = 0;
+    int declCount = 0;
+    int errorCount = 0;
 
     while (r.next()) {
+        if (r.is_declaration()) {
+            declCount++;
+        } else if (r.state() == xstream::Reader::Error) {
+            errorCount++;
+        }
         if (r.is_declaration() && r.path() == "?xml") {
             EXPECT_EQ(r.name(), "?xml");
             EXPECT_EQ(r.attribute("version", {}), "1.0");
@@ -179,6 +186,8 @@ TEST(XML, ProcessingInstructions)
         } else if (r.is_declaration() && r.path() == "!DOCTYPE") {
             EXPECT_EQ(r.name(), "!DOCTYPE");
             EXPECT_EQ(r.attribute("html", {}), "");
+        } else if (r.is_declaration()) {
+            EXPECT_EQ(r.path(), "?custom-instruction");
         } else if (r.match_start("/data/item")) {
             itemCount++;
             if (itemCount == 1) {
@@ -208,6 +217,9 @@ TEST(XML, ProcessingInstructions)
     }
 
     EXPECT_EQ(itemCount, 2);
+    EXPECT_EQ(declCount, 3);
+    // '!' is not a name-start character, so <!DOCTYPE html> is reported as an Error event and skipped
+    EXPECT_EQ(errorCount, 1);
 }
 
 // 再帰的なデータ構造の処理
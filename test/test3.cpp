@@ -0,0 +1,664 @@
+
+#include "test.h"
+#include <gtest/gtest.h>
+
+using namespace xstream;
+
+// 区切り文字の検索のテスト
+TEST(Scan, Find)
+{
+	std::string buf(300, 'x');
+	for (size_t len = 0; len < 150; len++) {
+		for (size_t pos = 0; pos <= len; pos += 7) {
+			std::string s = buf.substr(0, len);
+			if (pos < len) {
+				s[pos] = '<';
+			}
+			char const *begin = s.data();
+			char const *end = begin + s.size();
+			EXPECT_EQ(simd::find(begin, end, '<') - begin, (ptrdiff_t)pos);
+		}
+	}
+	std::string s = "]]]>]]x]]>";
+	EXPECT_EQ(simd::find(s.data(), s.data() + s.size(), "]]>", 3) - s.data(), 1);
+	EXPECT_EQ(simd::find(s.data() + 2, s.data() + s.size(), "]]>", 3) - s.data(), 7);
+	EXPECT_EQ(simd::find(s.data() + 8, s.data() + s.size(), "]]>", 3) - s.data(), (ptrdiff_t)s.size());
+}
+
+// レベルごとに実装が分かれる find_escape() と find_tag_end() がスカラー実装と一致するかテスト
+TEST(Scan, FindAllLevels)
+{
+	// 'x' の中にまばらに区切り文字を置いた入力
+	char const specials[] = ">\"'&<\n\t\x01\xe3";
+	std::vector<std::string> inputs;
+	uint32_t seed = 1;
+	for (size_t len = 0; len < 150; len++) {
+		std::string s;
+		for (size_t i = 0; i < len; i++) {
+			seed = seed * 1103515245 + 12345;
+			uint32_t v = seed >> 16;
+			s += v % 8 == 0 ? specials[(v / 8) % (sizeof(specials) - 1)] : 'x';
+		}
+		inputs.push_back(s);
+	}
+	auto scan = [&](){
+		std::vector<ptrdiff_t> out;
+		for (std::string const &s : inputs) {
+			char const *end = s.data() + s.size();
+			for (char const *p = s.data(); p <= end; p++) {
+				out.push_back(simd::find_escape(p, end, true) - p);
+				out.push_back(simd::find_escape(p, end, false) - p);
+				out.push_back(simd::find_tag_end(p, end) - p);
+			}
+		}
+		return out;
+	};
+	simd::Level saved = simd::level();
+	simd::set_level(simd::Scalar);
+	std::vector<ptrdiff_t> expected = scan();
+	for (simd::Level level : {simd::SSE2, simd::AVX2}) {
+		simd::set_level(level);
+		EXPECT_EQ(scan(), expected);
+	}
+	simd::set_level(saved);
+}
+
+// 長いテキスト・CDATA・コメントを含む文書のテスト
+TEST(Scan, LongText)
+{
+	std::string text;
+	for (int i = 0; i < 1000; i++) {
+		text += "lorem ipsum dolor sit amet ";
+	}
+	std::string xml = "<a title='" + text + "'>" + text + "<!--" + text + "--><![CDATA[" + text + "]]>" + text + "</a>";
+	simd::Level saved = simd::level();
+	for (simd::Level level : {simd::Scalar, simd::SSE2, simd::AVX2}) {
+		simd::set_level(level);
+		xstream::Reader r(xml);
+		int n = 0;
+		while (r.next()) {
+			if (r.match_start("/a")) {
+				EXPECT_EQ(r.attribute("title", {}), text);
+			} else if (r.match_end("/a")) {
+				EXPECT_EQ(r.text(), text + text + text);
+			}
+			n++;
+		}
+		EXPECT_EQ(n, 6);
+	}
+	simd::set_level(saved);
+}
+
+static void log_event(xstream::Reader &r, std::string *out)
+{
+	char tmp[16];
+	sprintf(tmp, "%d:", r.state());
+	*out += tmp;
+	if (r.is_start_element() || r.is_declaration()) {
+		*out += r.path() + "[";
+		for (auto const &a : r.attributes()) {
+			*out += a.first + "=" + a.second.to_string() + ";";
+		}
+		*out += "]";
+	} else if (r.is_end_element()) {
+		*out += r.path() + "{" + r.text() + "}";
+	} else if (r.is_characters()) {
+		auto v = r.characters().decode();
+		*out += std::string(v.data(), v.size());
+	}
+	*out += "\n";
+}
+
+// 入力を分割して与えるプッシュモードのテスト
+TEST(Reader, PushMode)
+{
+	std::string xml = R"---(<?xml version="1.0"?>
+<root a="1" b='x&gt;y'>
+	<item id="1">Hello &amp; welcome</item>
+	<!-- a comment -->
+	<item id="2"><![CDATA[<raw> & ]]>tail</item>
+	<empty name="e" />
+</root>
+)---";
+
+	std::string expected;
+	{
+		xstream::Reader r(xml);
+		while (r.next()) {
+			log_event(r, &expected);
+		}
+	}
+
+	for (size_t chunk = 1; chunk <= xml.size(); chunk++) {
+		std::string actual;
+		xstream::Reader r;
+		for (size_t pos = 0; pos < xml.size(); pos += chunk) {
+			r.feed(xml.data() + pos, std::min(chunk, xml.size() - pos));
+			while (r.next()) {
+				log_event(r, &actual);
+			}
+			ASSERT_TRUE(r.need_more());
+		}
+		r.finish();
+		while (r.next()) {
+			log_event(r, &actual);
+		}
+		EXPECT_EQ(r.state(), xstream::Reader::None);
+		EXPECT_EQ(actual, expected) << "chunk size " << chunk;
+	}
+}
+
+// メモリマップによるファイル読み込みのテスト
+TEST(Reader, OpenFile)
+{
+	std::string xml = R"---(<root><item id="1">Hello</item><item id="2">world</item></root>)---";
+	std::string path = ::testing::TempDir() + "xstream_open_file.xml";
+	FILE *fp = fopen(path.c_str(), "wb");
+	ASSERT_TRUE(fp);
+	fwrite(xml.data(), 1, xml.size(), fp);
+	fclose(fp);
+
+	auto r = xstream::Reader::open(path, xstream::MappedFile::Sequential | xstream::MappedFile::HugePages);
+	ASSERT_TRUE(r);
+	std::string text;
+	while (r->next()) {
+		if (r->match_end("/root/item")) {
+			text += r->attribute("id", {}) + ":" + r->text() + ";";
+		}
+	}
+	EXPECT_EQ(text, "1:Hello;2:world;");
+	remove(path.c_str());
+
+	EXPECT_FALSE(xstream::Reader::open(path));
+}
+
+// 深い入れ子と閉じられていない要素のパスのテスト
+TEST(Reader, Paths)
+{
+	std::string xml;
+	std::string path;
+	for (int i = 0; i < 100; i++) {
+		xml += "<e" + std::to_string(i) + ">";
+	}
+	for (int i = 99; i >= 0; i--) {
+		xml += "</e" + std::to_string(i) + ">";
+	}
+	xstream::Reader r(xml);
+	while (r.next()) {
+		if (r.is_start_element()) {
+			path += "/" + r.name();
+			EXPECT_EQ(r.path(), path);
+			EXPECT_TRUE(r.match_start(path.c_str()));
+		} else if (r.is_end_element()) {
+			EXPECT_EQ(r.path(), path);
+			EXPECT_TRUE(r.match_end((path + "/").c_str()));
+			path.resize(path.rfind('/'));
+		}
+	}
+	EXPECT_EQ(path, "");
+
+	std::string html = R"---(<html><body><p>a<br>b</p><p>c</p></body></html>)---";
+	std::string ends;
+	xstream::Reader h(html);
+	while (h.next()) {
+		if (h.is_end_element()) {
+			ends += h.path() + ";";
+		}
+	}
+	EXPECT_EQ(ends, "/html/body/p/br;/html/body/p;/html/body;/html;");
+}
+
+// コンパイル済みパスパターンのテスト
+TEST(Reader, PathSet)
+{
+	std::string xml = R"---(<root><a><b><c/></b></a><x><b><c/><y><c/></y></b></x></root>)---";
+
+	xstream::PathSet paths;
+	int abc = paths.add("/root/a/b/c");
+	int any_b = paths.add("/root/*/b");
+	int all_c = paths.add("//c");
+	int under_x = paths.add("/root/x//c");
+	int rel = paths.add("y/c");
+
+	std::string log;
+	xstream::Reader r(xml);
+	r.set_paths(&paths);
+	while (r.next()) {
+		if (r.is_start_element()) {
+			log += r.path() + ":";
+			for (int id : r.matches()) {
+				log += std::to_string(id);
+			}
+			log += ";";
+			EXPECT_EQ(r.match_start(all_c), r.name() == "c");
+		}
+		if (r.match_end(abc)) {
+			EXPECT_EQ(r.path(), "/root/a/b/c");
+		}
+	}
+	(void)any_b;
+	(void)under_x;
+	(void)rel;
+	EXPECT_EQ(log,
+		"/root:;"
+		"/root/a:;"
+		"/root/a/b:1;"
+		"/root/a/b/c:02;"
+		"/root/x:;"
+		"/root/x/b:1;"
+		"/root/x/b/c:23;"
+		"/root/x/b/y:;"
+		"/root/x/b/y/c:234;");
+}
+
+TEST(Reader, StaticPath)
+{
+	static constexpr xstream::StaticPath ITEM = "/root/item";
+	static constexpr xstream::StaticPath ROOT = "/root/";
+	std::string xml = R"---(<root><item>1</item><items><item>2</item></items><item>3</item></root>)---";
+	std::string text;
+	bool root = false;
+	xstream::Reader r(xml);
+	while (r.next()) {
+		if (r.match_start(ROOT)) {
+			root = true;
+		} else if (r.match_end(ITEM)) {
+			text += r.text();
+		}
+	}
+	EXPECT_TRUE(root);
+	EXPECT_EQ(text, "13");
+}
+
+// 属性の遅延解析のテスト
+TEST(Reader, LazyAttributes)
+{
+	std::string xml = R"---(<?xml version="1.0" encoding='UTF-8'?>
+<root a="1" b='x&gt;y' c="a>b/c">
+	<item id="1" n='/'>Hello</item>
+	<empty name="e"/>
+	<empty2 name="f" />
+	<x y=z>text</x>
+</root>
+)---";
+
+	std::string expected;
+	{
+		xstream::Reader r(xml);
+		while (r.next()) {
+			log_event(r, &expected);
+		}
+	}
+	EXPECT_NE(expected.find("c=a>b/c;"), std::string::npos);
+
+	std::string actual;
+	xstream::Reader r(xml);
+	r.set_lazy_attributes(true);
+	while (r.next()) {
+		log_event(r, &actual);
+	}
+	EXPECT_EQ(actual, expected);
+
+	std::string pushed;
+	xstream::Reader p;
+	p.set_lazy_attributes(true);
+	for (size_t pos = 0; pos < xml.size(); pos += 3) {
+		p.feed(xml.substr(pos, 3));
+		while (p.next()) {
+			if (p.is_end_element()) {
+				log_event(p, &pushed);
+			}
+		}
+	}
+	EXPECT_NE(pushed.find("/root{"), std::string::npos);
+	EXPECT_NE(pushed.find("/root/item{Hello}"), std::string::npos);
+
+	// 終了タグで初めて属性を参照する
+	xstream::Reader q(xml);
+	q.set_lazy_attributes(true);
+	std::string ids;
+	while (q.next()) {
+		if (q.match_end("/root/item")) {
+			ids = q.attribute("id", {}) + q.attribute("n", {});
+		}
+	}
+	EXPECT_EQ(ids, "1/");
+
+	// ブロック境界をまたぐ引用符付きの '>'
+	simd::Level saved = simd::level();
+	for (simd::Level level : {simd::Scalar, simd::SSE2, simd::AVX2}) {
+		simd::set_level(level);
+		for (size_t len = 0; len < 40; len++) {
+			std::string v(len, '>');
+			std::string doc = "<a x='" + v + "\"' y=\"" + v + "'\"/>";
+			xstream::Reader s(doc);
+			s.set_lazy_attributes(true);
+			ASSERT_TRUE(s.next());
+			EXPECT_EQ(s.attribute("x", {}), v + "\"");
+			EXPECT_EQ(s.attribute("y", {}), v + "'");
+		}
+	}
+	simd::set_level(saved);
+}
+
+// 文字参照・実体参照のデコードのテスト
+TEST(Decode, Entities)
+{
+	auto decode = [](std::string_view s){
+		std::string out;
+		html_decode_to(s.data(), s.data() + s.size(), std::back_inserter(out));
+		EXPECT_LE(out.size(), s.size());
+		EXPECT_EQ(html_decode(s), out);
+		return out;
+	};
+	EXPECT_EQ(decode("a&lt;b&gt;c&amp;d&quot;e&apos;f"), "a<b>c&d\"e'f");
+	EXPECT_EQ(decode("&#65;&#x42;&#X43;"), "ABC");
+	EXPECT_EQ(decode("&#233;&#x3042;&#x1F600;"), "\xc3\xa9\xe3\x81\x82\xf0\x9f\x98\x80");
+	EXPECT_EQ(decode("&#x0010FFFF;"), "\xf4\x8f\xbf\xbf");
+	EXPECT_EQ(decode("&unknown; & &#xZZ; &#0; &#xD800; &#x110000; &#; &#x;"), "&unknown; & &#xZZ; &#0; &#xD800; &#x110000; &#; &#x;");
+	EXPECT_EQ(decode("&ampersand;&lt"), "&ampersand;&lt");
+
+	// 範囲外の ';' を読まない
+	std::string buf = "x&amp;";
+	EXPECT_EQ(decode(std::string_view(buf.data(), 5)), "x&amp");
+
+	xstream::Reader r(R"---(<a v="&#x3042;&amp;">&#12354;<![CDATA[&amp;]]></a>)---");
+	ASSERT_TRUE(r.next());
+	auto v = r.attribute("v");
+	ASSERT_TRUE(v);
+	char tmp[16];
+	ASSERT_LE(v->size(), sizeof(tmp));
+	EXPECT_EQ(std::string(tmp, v->decode_to(tmp)), "\xe3\x81\x82&");
+	while (r.next()) {
+		if (r.is_end_element()) {
+			EXPECT_EQ(r.text(), "\xe3\x81\x82&amp;");
+		}
+	}
+}
+
+// エスケープ処理の各実装が1バイトずつの処理と一致するかテスト
+TEST(Encode, AllLevels)
+{
+	auto reference = [](std::string_view s, bool utf8through){
+		std::string out;
+		for (char ch : s) {
+			int c = ch & 0xff;
+			switch (c) {
+			case '&': out += "&amp;"; break;
+			case '<': out += "&lt;"; break;
+			case '>': out += "&gt;"; break;
+			case '\"': out += "&quot;"; break;
+			case '\'': out += "&apos;"; break;
+			default:
+				if (c < 0x80 ? (c < 0x20 && c != '\t' && c != '\n') : !utf8through) {
+					out += "&#" + std::to_string(c) + ";";
+				} else {
+					out += (char)c;
+				}
+			}
+		}
+		return out;
+	};
+
+	std::string bytes;
+	for (int i = 0; i < 256; i++) {
+		bytes += (char)i;
+	}
+	unsigned int seed = 1;
+	std::string noise;
+	for (int i = 0; i < 1000; i++) {
+		seed = seed * 1103515245 + 12345;
+		int r = (seed >> 16) % 64;
+		noise += r < 48 ? (char)('a' + r % 26) : bytes[(seed >> 8) & 0xff];
+	}
+
+	simd::Level saved = simd::level();
+	for (simd::Level level : {simd::Scalar, simd::SSE2, simd::AVX2}) {
+		simd::set_level(level);
+		for (bool utf8through : {true, false}) {
+			EXPECT_EQ(html_encode(bytes, utf8through), reference(bytes, utf8through));
+			for (size_t len = 0; len < 70; len++) {
+				std::string_view s(noise.data() + len, len);
+				EXPECT_EQ(html_encode(s, utf8through), reference(s, utf8through));
+			}
+			EXPECT_EQ(html_encode(noise, utf8through), reference(noise, utf8through));
+		}
+	}
+	simd::set_level(saved);
+	EXPECT_EQ(html_encode("plain text\tand\nnewlines"), "plain text\tand\nnewlines");
+	noise.erase(std::remove(noise.begin(), noise.end(), '\0'), noise.end()); // &#0; is not a valid reference
+	EXPECT_EQ(html_decode(html_encode(noise)), noise);
+}
+
+// 部分木の読み飛ばしのテスト
+TEST(Reader, SkipElement)
+{
+	std::string xml = R"---(<root>
+	<skip a="x>y" b='<c>'>
+		<child><!-- </skip> --><![CDATA[</skip>]]><?pi </skip> ?></child>
+		<empty/><empty2 q="/"/>
+		text &amp; more
+		<skip><skip>nested</skip></skip>
+	</skip>
+	<keep id="1">kept</keep>
+	<skip/>
+	<keep id="2"><x/></keep>
+</root>)---";
+
+	bool skipping = false; // push mode: the skip continues in later next() calls
+	auto read = [&](xstream::Reader &r, std::string *log){
+		while (r.next()) {
+			if (skipping || (r.is_start_element() && r.is_name("skip"))) {
+				if (!skipping) {
+					*log += "skip(" + r.path() + ")";
+					if (!r.skip_element()) {
+						skipping = r.need_more();
+						break;
+					}
+				}
+				skipping = false;
+				EXPECT_TRUE(r.is_end_element("skip"));
+				*log += r.attribute("a", {}) + r.text() + ";";
+			} else if (r.is_start_element()) {
+				*log += "<" + r.name() + ">";
+			} else if (r.is_end_element()) {
+				*log += "</" + r.name() + ":" + r.text() + ">";
+			}
+		}
+	};
+	char const *expected = "<root>skip(/root/skip)x>y;<keep></keep:kept>skip(/root/skip);<keep><x></x:></keep:></root:\n\t\n\t\n\t\n\t\n>";
+
+	std::string log;
+	xstream::Reader r(xml);
+	read(r, &log);
+	EXPECT_EQ(log, expected);
+	EXPECT_EQ(r.state(), xstream::Reader::None);
+
+	for (size_t chunk = 1; chunk < 40; chunk++) {
+		std::string pushed;
+		xstream::Reader p;
+		for (size_t pos = 0; pos < xml.size(); pos += chunk) {
+			p.feed(xml.substr(pos, chunk));
+			read(p, &pushed);
+		}
+		p.finish();
+		read(p, &pushed);
+		EXPECT_EQ(pushed, expected) << "chunk size " << chunk;
+	}
+
+	// nest() の内側での読み飛ばし
+	xstream::Reader n(xml);
+	std::string ids;
+	while (n.next()) {
+		if (n.match_start("/root")) {
+			n.nest();
+			while (n.next()) {
+				if (n.is_start_element("skip")) {
+					n.skip_element();
+				} else if (n.is_start_element("keep")) {
+					ids += n.attribute("id", {});
+				}
+			}
+			ids += "|" + n.path();
+		}
+	}
+	EXPECT_EQ(ids, "12|/root");
+
+	// 終端のない部分木
+	xstream::Reader u("<a><b><c>");
+	ASSERT_TRUE(u.next());
+	EXPECT_FALSE(u.skip_element());
+	EXPECT_FALSE(u.next());
+}
+
+// 要素の元のバイト列 (outer/inner XML) のテスト
+TEST(Reader, OuterXml)
+{
+	std::string item = R"---(<item id="1" q='a>b'>x<b>y</b><!-- </item> --><![CDATA[</item>]]><item>z</item></item>)---";
+	std::string xml = "<root>" + item + "<e/><f></f></root>";
+
+	xstream::Reader r(xml);
+	std::string log;
+	while (r.next()) {
+		if (r.is_start_element("root")) continue;
+		if (r.is_start_element() || r.is_end_element()) {
+			log += std::string(r.is_start_element() ? "+" : "-") + r.name() + "[" + std::string(r.outer_xml()) + "|" + std::string(r.inner_xml()) + "]";
+		}
+		if (r.is_start_element("item") && r.path() == "/root/item") {
+			EXPECT_EQ(r.outer_xml(), item);
+			EXPECT_EQ(r.outer_xml().data(), xml.data() + 6); // 入力のそのままの位置
+			ASSERT_TRUE(r.skip_element());
+			EXPECT_EQ(r.outer_xml(), item);
+		}
+	}
+	EXPECT_EQ(log,
+		"+item[" + item + "|" + item.substr(21, item.size() - 28) + "]"
+		"+e[<e/>|]-e[<e/>|]"
+		"+f[<f></f>|]-f[<f></f>|]"
+		"-root[" + xml + "|" + xml.substr(6, xml.size() - 13) + "]");
+
+	// プッシュモードではバッファ内にあるときだけ
+	xstream::Reader p;
+	p.feed("<a><b>1");
+	ASSERT_TRUE(p.next());
+	EXPECT_TRUE(p.outer_xml().empty());
+	ASSERT_TRUE(p.next());
+	EXPECT_TRUE(p.outer_xml().empty());
+	p.feed("</b></a>");
+	p.finish();
+	std::string ends;
+	while (p.next()) {
+		if (p.is_end_element()) {
+			ends += p.name() + "=" + std::string(p.outer_xml()) + ";";
+		}
+	}
+	EXPECT_EQ(ends, "b=;a=;");
+}
+
+// 複製しない文字データの参照と分割したデコードのテスト
+TEST(Reader, TextView)
+{
+	std::string xml = "<r><plain>just text</plain><ent>a &amp; b &#x41;&bogus; c</ent><cdata><![CDATA[<x>&amp;]]></cdata><mixed>a<![CDATA[b]]>c</mixed><note>x<!-- c -->y</note><one><!-- c -->only</one><empty></empty></r>";
+	xstream::Reader r(xml);
+	std::map<std::string, std::optional<std::string_view>> views;
+	std::map<std::string, std::string> chunked;
+	std::map<std::string, std::string> texts;
+	std::string buffer;
+	buffer.reserve(256);
+	char const *data = buffer.data();
+	while (r.next()) {
+		if (r.is_end_element() && r.depth() == 3) {
+			std::string name = r.name();
+			views[name] = r.text_view();
+			std::string joined;
+			int chunks = 0;
+			r.for_each_text_chunk([&](std::string_view s){
+				joined += s;
+				chunks++;
+			});
+			chunked[name] = joined;
+			r.text_into(buffer);
+			EXPECT_EQ(buffer, r.text());
+			EXPECT_EQ(buffer.data(), data); // 呼び出し側のバッファを再利用する
+			texts[name] = r.text();
+			if (name == "ent") {
+				EXPECT_EQ(chunks, 5); // "a ", "&", " b ", "A", "&bogus; c"
+			}
+		}
+	}
+	ASSERT_TRUE(views["plain"]);
+	EXPECT_EQ(*views["plain"], "just text");
+	EXPECT_GE(views["plain"]->data(), xml.data());
+	EXPECT_LT(views["plain"]->data(), xml.data() + xml.size());
+	EXPECT_FALSE(views["ent"]);
+	ASSERT_TRUE(views["cdata"]);
+	EXPECT_EQ(*views["cdata"], "<x>&amp;");
+	EXPECT_FALSE(views["mixed"]);
+	EXPECT_FALSE(views["note"]);
+	ASSERT_TRUE(views["one"]);
+	EXPECT_EQ(*views["one"], "only");
+	ASSERT_TRUE(views["empty"]);
+	EXPECT_EQ(*views["empty"], "");
+
+	EXPECT_EQ(texts["ent"], "a & b A&bogus; c");
+	for (auto const &t : texts) {
+		EXPECT_EQ(chunked[t.first], t.second) << t.first;
+	}
+}
+
+// 大きな文字データを一定の大きさに分けて読むテスト
+TEST(Reader, TextChunks)
+{
+	std::string payload;
+	for (int i = 0; payload.size() < 200000; i++) {
+		payload += "QUJDREVGR0hJSktMTU5PUFFSU1RVVldYWVo=";
+		payload += i % 3 == 0 ? "&amp;" : i % 3 == 1 ? "\xe3\x81\x82" : "&#x20AC;";
+	}
+	std::string cdata;
+	for (int i = 0; cdata.size() < 50000; i++) {
+		cdata += i % 7 == 0 ? "]" : i % 7 == 3 ? "c" : "\xe3\x81\x82";
+	}
+	std::string xml = "<doc><meta>m</meta><data>" + payload + "</data><raw><![CDATA[" + cdata + "]]></raw></doc>";
+	size_t const chunk = 1000;
+
+	auto check = [&](auto &r, std::string *data, std::string *raw){
+		while (r.next()) {
+			if (r.is_characters()) {
+				auto part = r.characters();
+				EXPECT_LE(part.raw().size(), chunk);
+				EXPECT_NE((unsigned char)part.raw()[0] & 0xc0, 0x80u); // UTF-8 の途中で切らない
+				auto v = part.decode();
+				(r.path() == "/doc/raw" ? raw : data)->append(v.data(), v.size());
+			} else if (r.is_end_element()) {
+				EXPECT_EQ(r.text(), "");
+			}
+		}
+	};
+
+	xstream::Reader r(xml);
+	r.set_text_chunk_size(chunk);
+	std::string data;
+	std::string raw;
+	check(r, &data, &raw);
+	EXPECT_EQ(data, "m" + xstream::html_decode(payload));
+	EXPECT_EQ(raw, cdata);
+
+	// プッシュモードでは保持するバッファが大きくならない
+	StatsReader p;
+	p.set_text_chunk_size(chunk);
+	data.clear();
+	raw.clear();
+	size_t allocations = 0;
+	for (size_t i = 0; i < xml.size(); i += 300) {
+		p.feed(xml.substr(i, 300));
+		check(p, &data, &raw);
+		if (i == 30000) {
+			allocations = p.stats().allocations;
+		}
+	}
+	p.finish();
+	check(p, &data, &raw);
+	EXPECT_EQ(data, "m" + xstream::html_decode(payload));
+	EXPECT_EQ(raw, cdata);
+	EXPECT_EQ(p.stats().allocations, allocations);
+}
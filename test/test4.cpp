@@ -0,0 +1,274 @@
+
+#include "test.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// ヒープ割り当て回数を数えるための operator new の置き換え
+
+static std::atomic<size_t> allocations{0};
+static std::atomic<size_t> allocated_bytes{0};
+static std::atomic<size_t> live_bytes{0}; // allocated and not yet freed
+
+// every form of new and delete goes through these two; the size is kept in a header for live_bytes
+static size_t const header_size = alignof(std::max_align_t);
+
+static void *allocate_(size_t size)
+{
+	allocations++;
+	allocated_bytes += size;
+	live_bytes += size;
+	char *p = (char *)malloc(header_size + size);
+	if (!p) throw std::bad_alloc();
+	memcpy(p, &size, sizeof size);
+	return p + header_size;
+}
+
+static void release_(void *ptr) noexcept
+{
+	if (!ptr) return;
+	char *p = (char *)ptr - header_size;
+	size_t size;
+	memcpy(&size, p, sizeof size);
+	live_bytes -= size;
+	free(p);
+}
+
+void *operator new(size_t size)
+{
+	return allocate_(size);
+}
+
+void *operator new[](size_t size)
+{
+	return allocate_(size);
+}
+
+void operator delete(void *p) noexcept
+{
+	release_(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+	release_(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	release_(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+	release_(p);
+}
+
+// 定常状態では要素ごとのヒープ割り当てが起きないことをテスト
+TEST(Reader, NoAllocationPerEvent)
+{
+	std::string record = R"---(<record id="42" name="a &amp; b"><title>Hello, &lt;world&gt;</title><!-- note --><data><![CDATA[<raw>]]></data><empty flag="1"/></record>)---";
+	std::string xml = "<root>";
+	for (int i = 0; i < 2000; i++) {
+		xml += record;
+	}
+	xml += "</root>";
+
+	xstream::Reader r(xml);
+	size_t events = 0;
+	size_t records = 0;
+	size_t before = 0;
+	while (r.next()) {
+		if (r.is_end_element() && r.is_name("record")) {
+			records++;
+			if (records == 100) {
+				before = allocations; // warmed up
+			}
+		} else if (r.is_start_element() && r.is_name("record")) {
+			EXPECT_TRUE(r.attribute("id"));
+		}
+		events++;
+	}
+	size_t after = allocations;
+	EXPECT_EQ(records, 2000u);
+	EXPECT_GT(events, 20000u);
+	EXPECT_EQ(after - before, 0u);
+}
+
+// reset() で読み込み器を再利用するテスト
+TEST(Reader, Reset)
+{
+	std::vector<std::string> messages;
+	for (int i = 0; i < 200; i++) {
+		messages.push_back("<msg id=\"" + std::to_string(i) + "\"><body>text " + std::to_string(i) + "</body></msg>");
+	}
+
+	xstream::Reader r(messages[0]);
+	size_t before = 0;
+	for (size_t i = 0; i < messages.size(); i++) {
+		if (i == 10) {
+			before = allocations;
+		}
+		r.reset(messages[i]);
+		int id = -1;
+		size_t bodies = 0;
+		while (r.next()) {
+			if (r.is_start_element() && r.is_name("msg")) {
+				auto a = r.attribute("id");
+				ASSERT_TRUE(a);
+				id = 0;
+				for (char c : a->to_string()) {
+					id = id * 10 + (c - '0');
+				}
+			} else if (r.is_end_element() && r.is_name("body")) {
+				bodies++;
+			}
+		}
+		EXPECT_EQ(id, (int)i);
+		EXPECT_EQ(bodies, 1u);
+		EXPECT_EQ(r.depth(), 1);
+	}
+	EXPECT_EQ(allocations - before, 0u);
+
+	// 途中で打ち切った文書からのリセット
+	r.reset("<a><b><c>");
+	while (r.next()) {
+	}
+	r.reset("<x/>");
+	ASSERT_TRUE(r.next());
+	EXPECT_TRUE(r.match_start("/x"));
+
+	// プッシュモードへのリセット
+	r.reset();
+	r.feed("<y>1</y>");
+	r.finish();
+	std::string text;
+	while (r.next()) {
+		if (r.is_end_element()) {
+			text = r.text();
+		}
+	}
+	EXPECT_EQ(text, "1");
+}
+
+// 多数のレコードを流してもプッシュモードで保持するメモリが一定に収まるかテスト
+TEST(Reader, PushModeBounded)
+{
+	auto run = [](size_t records){
+		std::string xml = "<root>";
+		for (size_t i = 0; i < records; i++) {
+			xml += "\n" + std::string(32, ' ') + "<record id=\"" + std::to_string(i) + "\"><name>item</name></record>";
+		}
+		xml += "\n</root>\n";
+		size_t before = live_bytes;
+		size_t peak = 0;
+		xstream::Reader r;
+		size_t names = 0;
+		for (size_t i = 0; i < xml.size(); i += 4096) {
+			r.feed(xml.substr(i, 4096));
+			while (r.next()) {
+				if (r.is_end_element("name")) {
+					names += r.text() == "item";
+				}
+			}
+			peak = std::max(peak, live_bytes - before);
+		}
+		r.finish();
+		while (r.next()) {
+		}
+		EXPECT_EQ(names, records);
+		return peak;
+	};
+	size_t small = run(20000);
+	size_t large = run(200000);
+	// ルート要素の空白 (6.6 MB) は保持せず、1 MiB の上限で捨てられる
+	EXPECT_LT(small, (size_t)4 << 20);
+	EXPECT_LT(large, (size_t)4 << 20);
+
+	// 上限を越えた要素の文字データは text() に残らず、characters() で読める
+	xstream::Reader r;
+	r.set_push_text_limit(100);
+	std::string xml = "<a>" + std::string(300, 'x') + "<b/>" + std::string(300, 'y') + "</a>";
+	size_t chars = 0;
+	for (size_t i = 0; i < xml.size(); i += 50) {
+		r.feed(xml.substr(i, 50));
+		while (r.next()) {
+			if (r.is_characters()) {
+				chars += r.characters().raw().size();
+			} else if (r.is_end_element("a")) {
+				EXPECT_EQ(r.text(), "");
+			}
+		}
+	}
+	r.finish();
+	while (r.next()) {
+		if (r.is_characters()) {
+			chars += r.characters().raw().size();
+		} else if (r.is_end_element("a")) {
+			EXPECT_EQ(r.text(), "");
+		}
+	}
+	EXPECT_EQ(chars, 600u);
+}
+
+// 統計カウンタのテスト
+TEST(Reader, Stats)
+{
+	std::string xml = "<root><a x=\"1\" y=\"&lt;2&gt;\"><b>t &amp; u<!--note--></b><![CDATA[<cdata>]]></a><c/></root>";
+
+	StatsReader r(xml);
+	std::string y;
+	std::string text;
+	while (r.next()) {
+		if (r.is_start_element("a")) {
+			y = r.attribute("y", {});
+		} else if (r.is_end_element("b")) {
+			text = r.text();
+		}
+	}
+	EXPECT_EQ(y, "<2>");
+	EXPECT_EQ(text, "t & u");
+
+	xstream::Reader::Stats const &s = r.stats();
+	EXPECT_EQ(s.bytes, xml.size());
+	EXPECT_EQ(s.events[xstream::Reader::StartElement], 4u);
+	EXPECT_EQ(s.events[xstream::Reader::EndElement], 4u);
+	EXPECT_EQ(s.events[xstream::Reader::Characters], 2u); // "t & u" and the CDATA section
+	EXPECT_EQ(s.events[xstream::Reader::Comment], 1u);
+	EXPECT_EQ(s.attributes, 2u);
+	EXPECT_EQ(s.entities, 3u);
+	EXPECT_EQ(s.cdata_bytes, 7u);
+	EXPECT_EQ(s.comment_bytes, 4u);
+	EXPECT_EQ(s.max_depth, 4u);
+	EXPECT_EQ(s.max_parts, 2u);
+	EXPECT_GT(s.allocations, 0u);
+
+	// 再利用した読み込み器は割り当てを増やさず、統計は積算される
+	xstream::Reader::Stats first = s;
+	r.reset(xml);
+	while (r.next()) {
+	}
+	EXPECT_EQ(s.bytes, 2 * xml.size());
+	EXPECT_EQ(s.allocations, first.allocations);
+
+	xstream::Reader::Stats total;
+	total += first;
+	total += first;
+	EXPECT_EQ(total.events[xstream::Reader::StartElement], 8u);
+	EXPECT_EQ(total.max_depth, 4u);
+
+	r.reset_stats();
+	EXPECT_EQ(r.stats().bytes, 0u);
+
+	// 置換されない '&' は数えない
+	r.reset("<a>&bogus; & x &amp;</a>");
+	while (r.next()) {
+		if (r.is_end_element()) {
+			EXPECT_EQ(r.text(), "&bogus; & x &");
+		}
+	}
+	EXPECT_EQ(r.stats().entities, 1u);
+}
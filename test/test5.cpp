@@ -0,0 +1,246 @@
+
+#include "test.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <limits>
+
+using namespace xstream;
+
+template <typename W> static void write_sample(W &w)
+{
+	w.start_document();
+	w.start_element("root");
+	w.write_attribute("a", "1 & 2");
+	for (int i = 0; i < 3; i++) {
+		w.start_element("item");
+		w.write_attribute("id", std::to_string(i));
+		w.write_characters("Hello <world>");
+		w.end_element();
+	}
+	w.element("empty", nullptr);
+	w.element("nested", [&](){
+		w.text_element("x", "y");
+	});
+	w.write_characters("tail");
+	w.end_document();
+}
+
+static char const *sample = R"---(<?xml version="1.0" encoding="UTF-8"?>
+<root a="1 &amp; 2">
+    <item id="0">Hello &lt;world&gt;</item>
+    <item id="1">Hello &lt;world&gt;</item>
+    <item id="2">Hello &lt;world&gt;</item>
+    <empty />
+    <nested>
+        <x>y</x>
+    </nested>tail</root>
+)---";
+
+// 関数を出力先とする Writer が大きなブロック単位で書き出すかテスト
+TEST(Writer, FunctionSink)
+{
+	std::string out;
+	int calls = 0;
+	{
+		Writer w([&](char const *p, int n){
+			out.append(p, n);
+			calls++;
+			return n;
+		});
+		write_sample(w);
+		EXPECT_EQ(calls, 1);
+	}
+	EXPECT_EQ(out, sample);
+
+	// 呼び出せない型からは作れない
+	static_assert(std::is_constructible_v<FunctionSink, int (*)(char const *, int)>);
+	static_assert(!std::is_constructible_v<FunctionSink, int>);
+	static_assert(!std::is_constructible_v<FunctionSink, std::string>);
+}
+
+// 書きかけの Writer をムーブしても出力が続くかテスト
+TEST(Writer, Move)
+{
+	std::string expected;
+	{
+		BasicWriter<StringSink> w(&expected);
+		w.start_document();
+		w.start_element("root");
+		w.write_attribute("a", "1");
+		w.text_element("x", "y");
+		w.end_document();
+	}
+	std::string s;
+	{
+		BasicWriter<StringSink> w(&s);
+		w.start_document();
+		w.start_element("root");
+		BasicWriter<StringSink> m(std::move(w));
+		m.write_attribute("a", "1");
+		std::string other;
+		BasicWriter<StringSink> n(&other);
+		n = std::move(m);
+		n.text_element("x", "y");
+		n.end_document();
+	}
+	EXPECT_EQ(s, expected);
+}
+
+// 各種出力先とバッファサイズで同じ出力になるかテスト
+TEST(Writer, Sinks)
+{
+	for (size_t size : {0, 1, 7, 64, 65536}) {
+		std::string s;
+		{
+			BasicWriter<StringSink> w(&s, size);
+			write_sample(w);
+		}
+		EXPECT_EQ(s, sample) << "buffer size " << size;
+
+		std::vector<char> v;
+		{
+			BasicWriter<VectorSink> w(&v, size);
+			write_sample(w);
+		}
+		EXPECT_EQ(std::string(v.begin(), v.end()), sample);
+	}
+
+	FILE *fp = tmpfile();
+	ASSERT_TRUE(fp);
+	{
+		BasicWriter<FileSink> w(fp, 16);
+		write_sample(w);
+		EXPECT_FALSE(w.sink().failed());
+	}
+	{
+		BasicWriter<FdSink> w(fileno(fp));
+		fflush(fp);
+		w.start_element("fd");
+		w.end_document();
+		EXPECT_FALSE(w.sink().failed());
+	}
+	rewind(fp);
+	std::string text;
+	char buf[256];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+		text.append(buf, n);
+	}
+	fclose(fp);
+	EXPECT_EQ(text, std::string(sample) + "<fd />\n");
+}
+
+// end_document() を呼ばずに破棄しても出力されるかテスト
+TEST(Writer, FlushOnDestroy)
+{
+	std::string s;
+	{
+		BasicWriter<StringSink> w(&s);
+		w.start_element("a");
+		w.write_characters("x");
+		EXPECT_EQ(s, "");
+	}
+	EXPECT_EQ(s, "<a>x");
+}
+
+// インデント幅の変更と空白なしの出力のテスト
+TEST(Writer, Indent)
+{
+	std::string s;
+	{
+		BasicWriter<StringSink> w(&s);
+		w.set_indent(30);
+		w.start_element("a");
+		w.start_element("b");
+		w.start_element("c");
+		w.start_element("d");
+		w.end_document();
+	}
+	EXPECT_EQ(s, "<a>\n" + std::string(30, ' ') + "<b>\n" + std::string(60, ' ') + "<c>\n" + std::string(90, ' ') + "<d />\n"
+		+ std::string(60, ' ') + "</c>\n" + std::string(30, ' ') + "</b>\n</a>\n");
+
+	std::string c;
+	{
+		BasicWriter<StringSink> w(&c);
+		w.set_compact(true);
+		write_sample(w);
+	}
+	EXPECT_EQ(c, R"---(<?xml version="1.0" encoding="UTF-8"?><root a="1 &amp; 2"><item id="0">Hello &lt;world&gt;</item><item id="1">Hello &lt;world&gt;</item><item id="2">Hello &lt;world&gt;</item><empty/><nested><x>y</x></nested>tail</root>)---");
+}
+
+// 登録済みの要素名による書き出しのテスト
+TEST(Writer, Tags)
+{
+	std::string expected;
+	{
+		BasicWriter<StringSink> w(&expected);
+		write_sample(w);
+	}
+
+	std::string s;
+	{
+		BasicWriter<StringSink> w(&s);
+		auto root = w.tag("root");
+		auto item = w.tag("item");
+		EXPECT_EQ(w.tag("nested"), w.tag("nested"));
+		w.start_document();
+		w.start_element(root);
+		w.write_attribute("a", "1 & 2");
+		for (int i = 0; i < 3; i++) {
+			w.start_element(item);
+			w.write_attribute("id", std::to_string(i));
+			w.write_characters("Hello <world>");
+			w.end_element();
+		}
+		w.element(w.tag("empty"), nullptr);
+		w.element(w.tag("nested"), [&](){
+			w.text_element("x", "y");
+		});
+		w.write_characters("tail");
+		w.end_document();
+	}
+	EXPECT_EQ(s, expected);
+}
+
+// 数値・真偽値・エスケープ済み文字列の書き出しのテスト
+TEST(Writer, Numbers)
+{
+	for (size_t size : {1, 65536}) {
+		std::string s;
+		{
+			BasicWriter<StringSink> w(&s, size);
+			w.set_compact(true);
+			w.start_element("n");
+			w.write_attribute("i", -42);
+			w.write_attribute("u", 18446744073709551615ull);
+			w.write_attribute("d", 0.1);
+			w.write_attribute("f", 1.5f);
+			w.write_attribute("b", true);
+			w.write_attribute("s", "1 < 2");
+			w.write_attribute_raw("r", "&amp;");
+			w.write_characters(1e300);
+			w.write_characters(' ' == ' ');
+			w.write_characters((short)7);
+			w.write_raw("<x>&amp;</x>");
+			w.write_characters("<");
+			w.end_document();
+		}
+		EXPECT_EQ(s, R"---(<n i="-42" u="18446744073709551615" d="0.1" f="1.5" b="true" s="1 &lt; 2" r="&amp;">1e+300true7<x>&amp;</x>&lt;</n>)---");
+	}
+
+	// 有限でない値は xs:double の表記で書く
+	std::string s;
+	{
+		BasicWriter<StringSink> w(&s);
+		w.set_compact(true);
+		w.start_element("n");
+		w.write_attribute("nan", std::nan(""));
+		w.write_attribute("inf", HUGE_VAL);
+		w.write_attribute("ninf", -std::numeric_limits<float>::infinity());
+		w.write_characters(-HUGE_VAL);
+		w.write_characters(" ");
+		w.write_characters(-std::nan(""));
+		w.end_document();
+	}
+	EXPECT_EQ(s, R"---(<n nan="NaN" inf="INF" ninf="-INF">-INF NaN</n>)---");
+}
@@ -0,0 +1,100 @@
+
+#include "test.h"
+#include <xstream_dom.h>
+#include <gtest/gtest.h>
+
+using namespace xstream;
+
+// テープ形式の DOM の構築と走査のテスト
+TEST(Document, Navigate)
+{
+	std::string xml = R"---(<?xml version="1.0"?>
+<root a="1 &amp; 2">
+	<item id="1">Hello &amp; <![CDATA[<raw>]]>world</item>
+	<!-- note -->
+	<item id="2"><sub/>second</item>
+	<other>x<![CDATA[]]>y</other>
+</root>
+)---";
+	auto doc = Document::parse(xml);
+	ASSERT_TRUE(doc);
+	EXPECT_EQ(doc->kind(0), Document::Root);
+	EXPECT_EQ(doc->node(0).end, doc->size());
+
+	uint32_t decl = doc->first_child(0);
+	EXPECT_EQ(doc->kind(decl), Document::Declaration);
+	EXPECT_EQ(doc->attribute(decl, "version", {}), "1.0");
+
+	uint32_t root = doc->document_element();
+	ASSERT_NE(root, Document::npos);
+	EXPECT_EQ(doc->name(root), "root");
+	EXPECT_EQ(doc->attribute(root, "a", {}), "1 & 2");
+	EXPECT_EQ(doc->find("/root"), root);
+
+	std::string items;
+	for (uint32_t i = doc->first_element(root); i != Document::npos; i = doc->next_element(i)) {
+		items += std::string(doc->name(i)) + ":" + doc->attribute(i, "id", "-") + "=" + doc->text(i) + ";";
+		EXPECT_EQ(doc->parent(i), root);
+	}
+	EXPECT_EQ(items, "item:1=Hello & <raw>world;item:2=second;other:-=xy;");
+
+	uint32_t sub = doc->find("/root/item/sub");
+	EXPECT_EQ(sub, Document::npos); // 最初の item には sub がない
+	uint32_t item2 = doc->next_element(doc->find("/root/item"));
+	sub = doc->find("sub", item2);
+	ASSERT_NE(sub, Document::npos);
+	EXPECT_EQ(doc->first_child(sub), Document::npos);
+	EXPECT_EQ(doc->value(doc->next_sibling(sub)), "second");
+
+	uint32_t comment = doc->next_sibling(doc->find("/root/item"));
+	while (doc->kind(comment) == Document::Text) {
+		comment = doc->next_sibling(comment);
+	}
+	EXPECT_EQ(doc->kind(comment), Document::Comment);
+	EXPECT_EQ(doc->value(comment), " note ");
+
+	// 名前と値は元の入力を指す
+	EXPECT_EQ(doc->name(root).data(), xml.data() + xml.find("root"));
+	auto atts = doc->attributes(root);
+	ASSERT_EQ(atts.second - atts.first, 1);
+	EXPECT_EQ(doc->attribute_name(*atts.first), "a");
+	EXPECT_EQ(doc->attribute_value(*atts.first).raw(), "1 &amp; 2");
+}
+
+// 閉じられていない要素と不正な入力のテスト
+TEST(Document, Unbalanced)
+{
+	std::string html = "<html><body><p>a<br>b</p><p>c</body>";
+	auto doc = Document::parse(html);
+	ASSERT_TRUE(doc);
+	uint32_t body = doc->find("/html/body");
+	std::string ps;
+	for (uint32_t p = doc->first_element(body); p != Document::npos; p = doc->next_element(p)) {
+		ps += std::string(doc->name(p)) + "(" + doc->text(p) + ")";
+	}
+	EXPECT_EQ(ps, "p(a)p(c)");
+	EXPECT_EQ(doc->text(doc->find("/html/body/p/br")), "b");
+	EXPECT_EQ(doc->node(0).end, doc->size());
+
+	EXPECT_FALSE(Document::parse("<a><1></a>"));
+}
+
+// 空の CDATA セクションとコメントが直前のテキストを繰り返さないことのテスト
+TEST(Document, EmptySections)
+{
+	auto doc = Document::parse("<a>x<b>y</b><![CDATA[]]></a>");
+	ASSERT_TRUE(doc);
+	uint32_t a = doc->document_element();
+	EXPECT_EQ(doc->text(a), "x");
+	for (uint32_t i = a + 1; i < doc->node(a).end; i++) {
+		EXPECT_NE(doc->kind(i), Document::CDATA);
+	}
+
+	doc = Document::parse("<a>x<b>y</b><!----></a>");
+	ASSERT_TRUE(doc);
+	a = doc->document_element();
+	EXPECT_EQ(doc->text(a), "x");
+	for (uint32_t i = a + 1; i < doc->node(a).end; i++) {
+		EXPECT_NE(doc->kind(i), Document::Comment);
+	}
+}
@@ -0,0 +1,82 @@
+
+#include "test.h"
+#include <xstream_parallel.h>
+#include <gtest/gtest.h>
+
+using namespace xstream;
+
+// 子要素単位の並列読み込みが逐次読み込みと一致するかテスト
+TEST(Parallel, Records)
+{
+	std::string xml = "<?xml version=\"1.0\"?>\n<!-- <record id=\"x\"> -->\n<root>\n";
+	for (int i = 0; i < 500; i++) {
+		std::string id = std::to_string(i);
+		switch (i % 5) {
+		case 0:
+			xml += "<record id=\"" + id + "\">plain " + id + "</record>\n";
+			break;
+		case 1:
+			xml += "<record id=\"" + id + "\"><![CDATA[<record id=\"bad\">]]>cdata " + id + "</record>\n";
+			break;
+		case 2:
+			xml += "<record id=\"" + id + "\"><!-- <record id=\"bad\"> --><record id=\"nested\">inner</record>nested " + id + "</record>\n";
+			break;
+		case 3:
+			xml += "<record id=\"" + id + "\" note='a > b &lt;record id=\"bad\"'/>\n";
+			break;
+		default:
+			xml += "<other/><record\tid=\"" + id + "\"><record/>tab " + id + "</record>\n";
+			break;
+		}
+	}
+	xml += "</root>\n";
+
+	auto read = [](Reader &r, std::vector<std::string> *out){
+		std::string id = r.attribute("id", {});
+		std::string path = r.path();
+		if (id == "400") return; // 残りは読み飛ばされる
+		while (r.next()) {
+			if (r.is_end_element() && r.depth() == 3) {
+				out->push_back(path + ":" + id + ":" + r.text());
+				break;
+			}
+		}
+	};
+
+	std::vector<std::string> expected;
+	{
+		Reader r(xml);
+		while (r.next()) {
+			if (r.is_start_element() && r.depth() == 3) {
+				read(r, &expected);
+				if (r.is_start_element()) {
+					r.skip_element();
+				}
+			}
+		}
+	}
+	std::sort(expected.begin(), expected.end());
+	ASSERT_EQ(expected.size(), 599u);
+
+	for (unsigned threads : {1, 2, 4}) {
+		for (size_t chunk : {1, 64, 1000, 1 << 20}) {
+			ParallelOptions options;
+			options.threads = threads;
+			options.min_chunk = chunk;
+			std::vector<std::vector<std::string>> sinks(parallel_threads(options));
+			size_t n = parse_parallel(xml, [&](Reader &r, unsigned thread){
+				read(r, &sinks[thread]);
+			}, options);
+			EXPECT_EQ(n, 600u);
+			std::vector<std::string> actual;
+			for (auto const &v : sinks) {
+				actual.insert(actual.end(), v.begin(), v.end());
+			}
+			std::sort(actual.begin(), actual.end());
+			EXPECT_EQ(actual, expected) << threads << " threads, chunk " << chunk;
+		}
+	}
+
+	EXPECT_EQ(parse_parallel("", [](Reader &, unsigned){}), 0u);
+	EXPECT_EQ(parse_parallel("<root/>", [](Reader &, unsigned){}), 0u);
+}
@@ -0,0 +1,94 @@
+
+#include "test.h"
+#include <xstream_index.h>
+#include <gtest/gtest.h>
+
+using namespace xstream;
+
+// 要素の位置の索引の作成・保存・読み込みと、索引からの読み出しのテスト
+TEST(Index, BuildSaveLoad)
+{
+	std::string xml = "<?xml version=\"1.0\"?>\n<catalog>\n<books>\n";
+	for (int i = 0; i < 100; i++) {
+		xml += "<book isbn=\"" + std::to_string(1000 + i) + "\"><title>Book &amp; " + std::to_string(i) + "</title><note><![CDATA[</book>]]></note></book>\n";
+	}
+	xml += "</books>\n<magazines><magazine isbn=\"m&amp;1\"/></magazines>\n</catalog>\n";
+
+	PathSet paths;
+	int book = paths.add("/catalog/books/book");
+	int magazine = paths.add("//magazine");
+	Index index = Index::build(xml, paths, "isbn");
+	ASSERT_EQ(index.size(), 101u);
+	EXPECT_EQ(index.source_size(), xml.size());
+
+	std::string path = ::testing::TempDir() + "xstream_index.xsix";
+	ASSERT_TRUE(index.save(path));
+	auto loaded = Index::load(path);
+	ASSERT_TRUE(loaded);
+	remove(path.c_str());
+	ASSERT_EQ(loaded->size(), index.size());
+
+	size_t i = loaded->find("1042");
+	ASSERT_NE(i, Index::npos);
+	Index::Entry const &e = loaded->entry(i);
+	EXPECT_EQ((int)e.pattern, book);
+	EXPECT_EQ(e.depth, 4u);
+	EXPECT_EQ(loaded->parent_path(i), "/catalog/books");
+	EXPECT_EQ(xml.substr(e.begin, e.end - e.begin), "<book isbn=\"1042\"><title>Book &amp; 42</title><note><![CDATA[</book>]]></note></book>");
+
+	auto r = loaded->reader(xml, i);
+	ASSERT_TRUE(r);
+	std::string title;
+	int events = 0;
+	while (r->next()) {
+		if (r->match_start("/catalog/books/book")) {
+			EXPECT_EQ(r->attribute("isbn", {}), "1042");
+		} else if (r->match_end("/catalog/books/book/title")) {
+			title = r->text();
+		}
+		events++;
+	}
+	EXPECT_EQ(title, "Book & 42");
+	EXPECT_EQ(events, 8);
+
+	size_t m = loaded->find("m&1");
+	ASSERT_NE(m, Index::npos);
+	EXPECT_EQ((int)loaded->entry(m).pattern, magazine);
+	EXPECT_EQ(loaded->parent_path(m), "/catalog/magazines");
+	EXPECT_EQ(loaded->find("9999"), Index::npos);
+
+	// 元の文書と大きさが違えば読み出さない
+	EXPECT_FALSE(loaded->reader(xml + " ", i));
+
+	// 壊れた索引ファイル
+	FILE *fp = fopen(path.c_str(), "wb");
+	ASSERT_TRUE(fp);
+	fwrite("XSIX", 1, 4, fp);
+	fclose(fp);
+	EXPECT_FALSE(Index::load(path));
+	remove(path.c_str());
+	EXPECT_FALSE(Index::load(path));
+}
+
+// 閉じられていない要素を含む文書の索引のテスト
+TEST(Index, Unbalanced)
+{
+	std::string xml = "<root><a id=\"1\"><b id=\"2\"><c>x</a><a id=\"3\"/></root>";
+	PathSet paths;
+	paths.add("//a");
+	paths.add("//b");
+	Index index = Index::build(xml, paths, "id");
+	ASSERT_EQ(index.size(), 3u);
+	size_t end = xml.find("</a>") + 4;
+	EXPECT_EQ(index.entry(index.find("1")).end, end); // a
+	EXPECT_EQ(index.entry(index.find("2")).end, end); // b は </a> で閉じられる
+	Index::Entry const &e = index.entry(index.find("3"));
+	EXPECT_EQ(xml.substr(e.begin, e.end - e.begin), "<a id=\"3\"/>");
+
+	// 読み込み器の購読は元に戻る
+	PathSet other;
+	Reader r(xml);
+	r.set_paths(&other);
+	Index::build(r, paths);
+	EXPECT_EQ(r.paths(), &other);
+}
@@ -0,0 +1,121 @@
+
+#include "test.h"
+#include <gtest/gtest.h>
+
+using namespace xstream;
+
+namespace {
+
+struct Lean : ReaderPolicy {
+	static constexpr bool paths = false;
+	static constexpr bool text = false;
+	static constexpr bool comments = false;
+	static constexpr bool attributes = false;
+	static constexpr bool nesting = false;
+};
+
+struct NoComments : ReaderPolicy {
+	static constexpr bool comments = false;
+};
+
+// 状態・名前・深さ・文字データを一行ずつ記録する
+template <typename R> std::string events(R &r)
+{
+	std::string s;
+	while (r.next()) {
+		switch (r.state()) {
+		case R::StartElement:
+			s += "<" + r.name() + " " + std::to_string(r.depth()) + "\n";
+			break;
+		case R::EndElement:
+			s += "/" + r.name() + " " + std::to_string(r.depth()) + "\n";
+			break;
+		case R::Characters:
+		case R::Comment:
+			{
+				auto v = r.characters().decode();
+				s += (r.state() == R::Comment ? "#" : "'") + std::string(v.data(), v.size()) + "\n";
+			}
+			break;
+		default:
+			break;
+		}
+	}
+	return s;
+}
+
+} // namespace
+
+std::string const policy_xml = R"---(<?xml version="1.0"?>
+<root a="1"><item id="x>y" b='2'>one &amp; two<!-- note -->three</item><empty k="v"/><![CDATA[<raw>]]></root>)---";
+
+// 既定のポリシーと同じイベント列になることのテスト
+TEST(Policy, Lean)
+{
+	Reader full(policy_xml);
+	BasicReader<Lean> lean(policy_xml);
+	std::string expected = events(full);
+	std::string got = events(lean);
+
+	// コメントのイベントだけがなくなる
+	std::string without_comments;
+	for (size_t i = 0; i < expected.size();) {
+		size_t j = expected.find('\n', i) + 1;
+		if (expected[i] != '#') {
+			without_comments += expected.substr(i, j - i);
+		}
+		i = j;
+	}
+	EXPECT_NE(expected, without_comments);
+	EXPECT_EQ(got, without_comments);
+	EXPECT_EQ(lean.depth(), 1);
+}
+
+// コメントを落とすポリシーのテスト
+TEST(Policy, NoComments)
+{
+	BasicReader<NoComments> r(policy_xml);
+	std::string text;
+	std::string id;
+	while (r.next()) {
+		EXPECT_NE(r.state(), Reader::Comment);
+		if (r.match_start("/root/item")) {
+			id = r.attribute("id", {});
+		} else if (r.match_end("/root/item")) {
+			text = r.text();
+		}
+	}
+	EXPECT_EQ(id, "x>y");
+	EXPECT_EQ(text, "one & twothree");
+}
+
+// 機能を絞った読み込み器のプッシュモードと skip_element() のテスト
+TEST(Policy, PushAndSkip)
+{
+	Reader full(policy_xml);
+	std::string expected = events(full);
+
+	BasicReader<Lean> r;
+	std::string got;
+	for (size_t i = 0; i < policy_xml.size(); i += 7) {
+		r.feed(policy_xml.substr(i, 7));
+		got += events(r);
+		EXPECT_TRUE(r.need_more());
+	}
+	r.finish();
+	got += events(r);
+	BasicReader<Lean> batch(policy_xml);
+	EXPECT_EQ(got, events(batch));
+
+	BasicReader<Lean> s(policy_xml);
+	std::string outer;
+	while (s.next()) {
+		if (s.is_start_element("item")) {
+			outer = std::string(s.outer_xml());
+			ASSERT_TRUE(s.skip_element());
+			EXPECT_TRUE(s.is_end_element("item"));
+			EXPECT_EQ(s.depth(), 3);
+		}
+	}
+	EXPECT_EQ(outer, "<item id=\"x>y\" b='2'>one &amp; two<!-- note -->three</item>");
+}